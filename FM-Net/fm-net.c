@@ -1,8 +1,27 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdalign.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
+#define u8  uint8_t
 #define u32 uint32_t 
 #define u64 uint64_t 
 
@@ -38,33 +57,338 @@ u32 type_of(u64 ptrn) {
   return ptrn >= (u64)0x100000000 ? NUM : PTR;
 }
 
+// Node layout
+// ===========
+// By default a node is four u32 words: three ports and an info word holding
+// the kind, the type and a numeric flag per port. Building with
+// -DFM_WIDE_PORTS makes each word a u64 instead: ports then hold tagged
+// values in the same format as `Pointer` and `Numeric`, so reading or
+// writing a port is a single load or store, and the info word only holds the
+// kind and type. Net files and the built-in net always use the u32 layout.
+
+#ifdef FM_WIDE_PORTS
+typedef u64 Word;
+#else
+typedef u32 Word;
+#endif
+
 typedef struct Node {
-  u32 port[3];
-  u32 info;
+  Word port[3];
+  Word info;
 } Node;
 
+// Telemetry
+// =========
+// Building with -DFM_STATS counts interactions per rule and per OP1 kind,
+// samples the redex stack at every `loops` iteration, and tracks how far
+// the node and free buffers grew. -DFM_STATS_TIME also times each rule.
+// Without them, the hooks below expand to nothing.
+
+enum {
+  RULE_ANNIHILATION,
+  RULE_NODE_DUPLICATION,
+  RULE_UNARY_DUPLICATION,
+  RULE_PERMUTATION,
+  RULE_UNARY_OPERATION,
+  RULE_BINARY_OPERATION,
+  RULE_NUMBER_DUPLICATION,
+  RULE_IF_THEN_ELSE,
+  RULE_COUNT
+};
+
+#if defined(FM_STATS_TIME) && !defined(FM_STATS)
+#define FM_STATS
+#endif
+
+#ifdef FM_STATS
+typedef struct Telemetry {
+  u64 rules[RULE_COUNT];
+  u64 unary_kinds[16];
+  u64 rule_ns[RULE_COUNT];
+  u32 last_rule;
+  u64 depth_log2[33];
+  u64 depth_sum;
+  u32 depth_max;
+  u32 nodes_peak;
+  u32 freed_peak;
+} Telemetry;
+
+#define COUNT_RULE(net, rule) ((net)->tele.rules[rule]++, (net)->tele.last_rule = (rule))
+#define COUNT_UNARY(net, kind) ((net)->tele.unary_kinds[(kind) & 15]++)
+#define TRACK_PEAK(net, field, len) if ((len) > (net)->tele.field) (net)->tele.field = (len)
+#else
+#define COUNT_RULE(net, rule)
+#define COUNT_UNARY(net, kind)
+#define TRACK_PEAK(net, field, len)
+#endif
+
+#ifdef FM_STATS_TIME
+#define TIME_START() u64 rule_start = ticks()
+#define TIME_RULE(net) ((net)->tele.rule_ns[(net)->tele.last_rule] += ticks() - rule_start)
+#else
+#define TIME_START()
+#define TIME_RULE(net)
+#endif
+
+// Orders in which `reduce` takes redexes; see "Scheduling"
+#define SCHEDULE_LIFO 0
+#define SCHEDULE_FIFO 1
+#define SCHEDULE_SORTED 2
+
+const char *schedule_names[] = {"lifo", "fifo", "sorted"};
+
+// A reserved range of virtual memory whose pages are committed on demand
+typedef struct Arena {
+  u8 *base;
+  u64 size;
+  u64 committed;
+} Arena;
+
 typedef struct Net {
-  u32 *nodes;
+  Word *nodes;
   u32 nodes_len;
+  u32 nodes_end;
   u32 *redex;
   u32 redex_len;
+  u32 redex_end;
   u32 *freed;
   u32 freed_len;
+  u32 freed_end;
+  struct Net *parent;
+  struct Outbox *outbox;
+  u32 nodes_peak;
+  u32 compact_at;
+  u32 schedule;
+  u32 prefetch;
+  u32 batch_ops;
+  u64 pre_rewrites;
+  u64 source_size;
+  u64 source_hash;
+  Arena nodes_mem;
+  Arena redex_mem;
+  Arena freed_mem;
+  #ifdef FM_STATS
+  Telemetry tele;
+  #endif
 } Net;
 
+// `exhausted` is set when reduction stopped because the node buffer was full
 typedef struct Stats {
-  u32 rewrites;
-  u32 loops;
+  u64 rewrites;
+  u64 loops;
+  u32 exhausted;
+  #ifdef FM_STATS
+  Telemetry tele;
+  #endif
 } Stats;
 
-u32 alloc_node(Net *net, u32 type, u32 kind) {
-  u32 addr;
+// Monotonic clock, in nanoseconds
+u64 ticks() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Monotonic clock, in seconds
+double now() {
+  return ticks() * 1e-9;
+}
+
+#ifdef FM_STATS
+// Sums the counters of `src` into `dst`. Worker views allocate from their
+// parent's node buffer, so the node peak is the highest of them; free lists
+// are separate buffers, so their peaks add up.
+void merge_telemetry(Telemetry *dst, Telemetry *src) {
+  for (u32 i = 0; i < RULE_COUNT; ++i) {
+    dst->rules[i] += src->rules[i];
+    dst->rule_ns[i] += src->rule_ns[i];
+  }
+  for (u32 i = 0; i < 16; ++i) {
+    dst->unary_kinds[i] += src->unary_kinds[i];
+  }
+  for (u32 i = 0; i < 33; ++i) {
+    dst->depth_log2[i] += src->depth_log2[i];
+  }
+  dst->depth_sum += src->depth_sum;
+  if (src->depth_max > dst->depth_max) dst->depth_max = src->depth_max;
+  if (src->nodes_peak > dst->nodes_peak) dst->nodes_peak = src->nodes_peak;
+  dst->freed_peak += src->freed_peak;
+}
+
+void print_telemetry(Stats *stats) {
+  static const char *names[RULE_COUNT] = {
+    "annihilation", "node_duplication", "unary_duplication", "permutation",
+    "unary_operation", "binary_operation", "number_duplication", "if_then_else"
+  };
+  Telemetry *tele = &stats->tele;
+  for (u32 i = 0; i < RULE_COUNT; ++i) {
+    printf("rule %-19s %12lu", names[i], tele->rules[i]);
+    #ifdef FM_STATS_TIME
+    printf(" %10.3fs", tele->rule_ns[i] / 1e9);
+    #endif
+    printf("\n");
+  }
+  for (u32 i = 0; i < 16; ++i) {
+    if (tele->unary_kinds[i]) printf("unary kind %-2u %12lu\n", i, tele->unary_kinds[i]);
+  }
+  printf("redex depth: mean %.1f, max %u\n", stats->loops ? (double)tele->depth_sum / stats->loops : 0.0, tele->depth_max);
+  for (u32 i = 0; i < 33; ++i) {
+    if (tele->depth_log2[i]) printf("redex depth < 2^%-2u %10lu\n", i, tele->depth_log2[i]);
+  }
+  printf("peak nodes: %u\n", tele->nodes_peak);
+  printf("peak freed: %u\n", tele->freed_peak);
+}
+#endif
+
+// Memory
+// ======
+// Buffers are carved from reserved address space and committed in
+// COMMIT_GRAIN steps as they fill, so resident memory follows the net's
+// high-water mark. Running past a reservation is a clean error.
+
+#define COMMIT_GRAIN ((u64)2 << 20)
+#define MAX_NODES_BYTES ((u64)sizeof(Word) << 32)
+#define MAX_STACK_BYTES ((u64)1 << 32)
+
+static pthread_mutex_t grow_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void out_of_memory(const char *what) {
+  printf("[ERROR]\nOut of memory: %s buffer exhausted.\n", what);
+  exit(1);
+}
+
+// Reserves `size` bytes without committing them. With `huge`, the range is
+// aligned to and advised for transparent huge pages.
+u32 arena_reserve(Arena *arena, u64 size, u32 huge) {
+  size = (size + COMMIT_GRAIN - 1) & ~(COMMIT_GRAIN - 1);
+  arena->base = NULL;
+  arena->size = 0;
+  arena->committed = 0;
+  if (size == 0) return 1;
+  u64 pad = huge ? COMMIT_GRAIN : 0;
+  u8 *raw = mmap(NULL, size + pad, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (raw == MAP_FAILED) return 0;
+  u8 *base = raw;
+  if (huge) {
+    base = (u8*)(((uintptr_t)raw + pad - 1) & ~(uintptr_t)(pad - 1));
+    if (base > raw) munmap(raw, base - raw);
+    if (base < raw + pad) munmap(base + size, raw + pad - base);
+    madvise(base, size, MADV_HUGEPAGE);
+  }
+  arena->base = base;
+  arena->size = size;
+  return 1;
+}
+
+// Makes the first `bytes` of the arena writable. Fails when that is beyond
+// the reservation or the kernel refuses to commit more memory.
+u32 arena_commit(Arena *arena, u64 bytes) {
+  if (bytes <= arena->committed) return 1;
+  if (bytes > arena->size) return 0;
+  u64 target = (bytes + COMMIT_GRAIN - 1) & ~(COMMIT_GRAIN - 1);
+  if (target > arena->size) target = arena->size;
+  if (mprotect(arena->base + arena->committed, target - arena->committed, PROT_READ | PROT_WRITE) != 0) return 0;
+  arena->committed = target;
+  return 1;
+}
+
+void arena_release(Arena *arena) {
+  if (arena->base) munmap(arena->base, arena->size);
+  arena->base = NULL;
+  arena->size = 0;
+  arena->committed = 0;
+}
+
+// Reserves a net's buffers; `nodes_bytes` bounds the node buffer
+void net_init(Net *net, u64 nodes_bytes, u32 huge) {
+  if (nodes_bytes > MAX_NODES_BYTES) nodes_bytes = MAX_NODES_BYTES;
+  if (!arena_reserve(&net->nodes_mem, nodes_bytes, huge)
+    || !arena_reserve(&net->redex_mem, MAX_STACK_BYTES, huge)
+    || !arena_reserve(&net->freed_mem, MAX_STACK_BYTES, huge)) {
+    out_of_memory("address space");
+  }
+  net->nodes = (Word*)net->nodes_mem.base;
+  net->nodes_len = 0;
+  net->nodes_end = 0;
+  net->redex = (u32*)net->redex_mem.base;
+  net->redex_len = 0;
+  net->redex_end = 0;
+  net->freed = (u32*)net->freed_mem.base;
+  net->freed_len = 0;
+  net->freed_end = 0;
+  net->parent = NULL;
+  net->outbox = NULL;
+  net->nodes_peak = 0;
+  net->compact_at = 1 << 20;
+  net->schedule = SCHEDULE_LIFO;
+  net->prefetch = 4;
+  net->batch_ops = 0;
+  net->pre_rewrites = 0;
+  net->source_size = 0;
+  net->source_hash = 0;
+  #ifdef FM_STATS
+  memset(&net->tele, 0, sizeof(net->tele));
+  #endif
+}
+
+void net_free(Net *net) {
+  arena_release(&net->nodes_mem);
+  arena_release(&net->redex_mem);
+  arena_release(&net->freed_mem);
+}
+
+// Grows the node buffer to hold `words` words; fails past its reservation
+u32 grow_nodes(Net *net, u64 words) {
+  if (words <= net->nodes_end) return 1;
+  if (words > MAX_NODES_BYTES / sizeof(Word) || !arena_commit(&net->nodes_mem, words * sizeof(Word))) {
+    return 0;
+  }
+  u64 end = net->nodes_mem.committed / sizeof(Word);
+  net->nodes_end = end > 0xFFFFFFFC ? 0xFFFFFFFC : (u32)end;
+  return 1;
+}
+
+// Ensures the node buffer can hold `words` words
+void reserve_nodes(Net *net, u64 words) {
+  if (!grow_nodes(net, words)) out_of_memory("node");
+}
+
+// Grows a stack by at least one entry
+void grow_stack(Arena *arena, u32 *end, const char *what) {
+  if (!arena_commit(arena, ((u64)*end + 1) * 4)) out_of_memory(what);
+  u64 cap = arena->committed / 4;
+  *end = cap > 0xFFFFFFFF ? 0xFFFFFFFF : (u32)cap;
+}
+
+void push_redex(Net *net, u32 addr) {
+  if (net->redex_len == net->redex_end) grow_stack(&net->redex_mem, &net->redex_end, "redex");
+  net->redex[net->redex_len++] = addr;
+}
+
+void push_freed(Net *net, u32 addr) {
+  if (net->freed_len == net->freed_end) grow_stack(&net->freed_mem, &net->freed_end, "free list");
+  net->freed[net->freed_len++] = addr;
+  TRACK_PEAK(net, freed_peak, net->freed_len);
+}
+
+// Extends the bump area of a net. A worker's view of the net claims a chunk
+// of its parent's buffer instead, growing the parent under `grow_lock`.
+void refill_chunk(Net *net);
+
+// Takes a node from the free list or the bump area, leaving it uninitialized
+u32 alloc_addr(Net *net) {
   if (net->freed_len > 0) {
-    addr = net->freed[--net->freed_len];
-  } else {
-    addr = net->nodes_len / 4;
-    net->nodes_len += 4;
+    return net->freed[--net->freed_len];
   }
+  if (net->nodes_len == net->nodes_end) refill_chunk(net);
+  u32 addr = net->nodes_len / 4;
+  net->nodes_len += 4;
+  TRACK_PEAK(net, nodes_peak, net->nodes_len / 4);
+  return addr;
+}
+
+u32 alloc_node(Net *net, u32 type, u32 kind) {
+  u32 addr = alloc_addr(net);
   net->nodes[addr * 4 + 0] = addr * 4 + 0;
   net->nodes[addr * 4 + 1] = addr * 4 + 1;
   net->nodes[addr * 4 + 2] = addr * 4 + 2;
@@ -77,7 +401,7 @@ void free_node(Net *net, u32 addr) {
   net->nodes[addr * 4 + 1] = addr * 4 + 1;
   net->nodes[addr * 4 + 2] = addr * 4 + 2;
   net->nodes[addr * 4 + 3] = 0;
-  net->freed[net->freed_len++] = addr;
+  push_freed(net, addr);
 }
 
 u32 is_free(Net *net, u32 addr) {
@@ -87,11 +411,24 @@ u32 is_free(Net *net, u32 addr) {
       && net->nodes[addr * 4 + 3] == 0;
 }
 
+#ifdef FM_WIDE_PORTS
+u32 is_numeric(Net *net, u32 addr, u32 slot) {
+  return type_of(net->nodes[addr * 4 + slot]);
+}
+
+void write_port(Net *net, u32 addr, u32 slot, u64 ptrn) {
+  net->nodes[addr * 4 + slot] = ptrn;
+}
+
+u64 get_port(Net* net, u32 addr, u32 slot) {
+  return net->nodes[addr * 4 + slot];
+}
+#else
 u32 is_numeric(Net *net, u32 addr, u32 slot) {
   return (net->nodes[addr * 4 + 3] >> slot) & 1;
 }
 
-void set_port(Net *net, u32 addr, u32 slot, u64 ptrn) {
+void write_port(Net *net, u32 addr, u32 slot, u64 ptrn) {
   if (type_of(ptrn) == NUM) {
       net->nodes[addr * 4 + slot] = numb_of(ptrn);
       net->nodes[addr * 4 + 3]    = net->nodes[addr * 4 + 3] | (1 << slot);
@@ -104,6 +441,17 @@ void set_port(Net *net, u32 addr, u32 slot, u64 ptrn) {
 u64 get_port(Net* net, u32 addr, u32 slot) {
   return (u64)net->nodes[addr * 4 + slot] + (is_numeric(net, addr, slot) ? (u64)0x100000000 : (u64)0);
 }
+#endif
+
+// A shard's view of the net holds back writes to other shards' nodes and
+// reads them back until they are sent; see the sharded reducer
+u32 defer_port(Net *net, u32 addr, u32 slot, u64 ptrn);
+u32 deferred_port(Net *net, u32 addr, u32 slot, u64 *ptrn);
+
+void set_port(Net *net, u32 addr, u32 slot, u64 ptrn) {
+  if (__builtin_expect(net->outbox != NULL, 0) && defer_port(net, addr, slot, ptrn)) return;
+  write_port(net, addr, slot, ptrn);
+}
 
 void set_type(Net* net, u32 addr, u32 type) {
   net->nodes[addr * 4 + 3] = (net->nodes[addr * 4 + 3] & ~0b111000) | (type << 3);
@@ -117,12 +465,60 @@ u32 get_kind(Net* net, u32 addr) {
   return net->nodes[addr * 4 + 3] >> 6;
 }
 
+// Overwrites all of a node's words at once
+void write_node(Net *net, u32 addr, u64 p0, u64 p1, u64 p2, u32 type, u32 kind) {
+  #ifdef FM_WIDE_PORTS
+  net->nodes[addr * 4 + 0] = p0;
+  net->nodes[addr * 4 + 1] = p1;
+  net->nodes[addr * 4 + 2] = p2;
+  net->nodes[addr * 4 + 3] = (kind << 6) + ((type & 0x7) << 3);
+  #else
+  net->nodes[addr * 4 + 0] = numb_of(p0);
+  net->nodes[addr * 4 + 1] = numb_of(p1);
+  net->nodes[addr * 4 + 2] = numb_of(p2);
+  net->nodes[addr * 4 + 3] = (kind << 6) + ((type & 0x7) << 3) + (type_of(p0) << 0) + (type_of(p1) << 1) + (type_of(p2) << 2);
+  #endif
+}
+
+// Copies node words in the u32 layout into the net, converting if needed
+void put_words(Net *net, u32 at, const u32 *words, u32 len) {
+  #ifdef FM_WIDE_PORTS
+  for (u32 i = 0; i < len; i += 4) {
+    u32 info = words[i + 3];
+    for (u32 slot = 0; slot < 3; ++slot) {
+      net->nodes[at + i + slot] = words[i + slot] + ((info >> slot) & 1 ? (u64)0x100000000 : (u64)0);
+    }
+    net->nodes[at + i + 3] = info & ~0x7;
+  }
+  #else
+  memcpy(net->nodes + at, words, sizeof(u32) * len);
+  #endif
+}
+
+// Copies node words out of the net in the u32 layout
+void get_words(Net *net, u32 at, u32 *words, u32 len) {
+  #ifdef FM_WIDE_PORTS
+  for (u32 i = 0; i < len; i += 4) {
+    u32 info = (u32)net->nodes[at + i + 3];
+    for (u32 slot = 0; slot < 3; ++slot) {
+      words[i + slot] = (u32)net->nodes[at + i + slot];
+      info |= type_of(net->nodes[at + i + slot]) << slot;
+    }
+    words[i + 3] = info;
+  }
+  #else
+  memcpy(words, net->nodes + at, sizeof(u32) * len);
+  #endif
+}
+
 // Given a pointer to a port, returns a pointer to the opposing port
 u64 enter_port(Net* net, u64 ptrn) {
   if (type_of(ptrn) == NUM) { 
     printf("[ERROR]\nCan't enter a numeric pointer.");
     return 0;
   } else {
+    u64 held;
+    if (__builtin_expect(net->outbox != NULL, 0) && deferred_port(net, addr_of(ptrn), slot_of(ptrn), &held)) return held;
     return get_port(net, addr_of(ptrn), slot_of(ptrn));
   }
 }
@@ -144,7 +540,7 @@ void link_ports(Net *net, u64 a_ptrn, u64 b_ptrn) {
 
   // If both are main ports, add this to the list of active pairs
   if (!(a_numb && b_numb) && (a_numb || slot_of(a_ptrn) == 0) && (b_numb || slot_of(b_ptrn) == 0)) {
-    net->redex[net->redex_len++] = a_numb ? addr_of(b_ptrn) : addr_of(a_ptrn);
+    push_redex(net, a_numb ? addr_of(b_ptrn) : addr_of(a_ptrn));
   }
 }
 
@@ -159,253 +555,2813 @@ void unlink_port(Net* net, u64 a_ptrn) {
   }
 }
 
+// Rules
+// =====
+// `rewrite` picks the rule for a pair from a table indexed by whether the
+// pair is numeric and by the types of both nodes. Rules read each node's
+// ports once and build new nodes in place. A pair whose aux ports are wired
+// to each other instead goes through `*_wired`, which relinks port by port so
+// such wires collapse correctly.
+
+typedef void (*Rule)(Net *net, u32 a_addr, u32 b);
+
+// Points the external port `ext` at `ptrn`, the main port of a node that was
+// just written, queueing the pair when both are main ports, like `link_ports`
+void attach(Net *net, u64 ptrn, u64 ext) {
+  if (type_of(ext) == PTR) {
+    set_port(net, addr_of(ext), slot_of(ext), ptrn);
+    if (slot_of(ext) != 0) return;
+  }
+  push_redex(net, addr_of(ptrn));
+}
+
+// Whether `ptrn` points into node `a` or `b`
+u32 is_wired(u64 ptrn, u32 a_addr, u32 b_addr) {
+  return type_of(ptrn) == PTR && (addr_of(ptrn) == a_addr || addr_of(ptrn) == b_addr);
+}
+
+void invalid_rule(Net *net, u32 a_addr, u32 b) {
+  (void)net;
+  (void)a_addr;
+  (void)b;
+  printf("[ERROR]\nInvalid interaction.");
+}
+
+// UnaryOperation
+// Integer power by squaring, wrapping like the other operations
+u32 pow_u32(u32 base, u32 exp) {
+  u32 res = 1;
+  for (; exp; exp >>= 1) {
+    if (exp & 1) res *= base;
+    base *= base;
+  }
+  return res;
+}
+
+// Shift counts are taken mod 32, as x86 does, so batches agree with it
+u32 apply_op(u32 kind, u32 fst, u32 snd) {
+  switch (kind) {
+    case  0: return fst + snd;
+    case  1: return fst - snd;
+    case  2: return fst * snd;
+    case  3: return fst / snd;
+    case  4: return fst % snd;
+    case  5: return pow_u32(fst, snd);
+    case  6: return (u32)(pow((float)fst, ((float)snd / pow(2.0,32.0))));
+    case  7: return fst & snd;
+    case  8: return fst | snd;
+    case  9: return fst ^ snd;
+    case 10: return ~snd;
+    case 11: return fst >> (snd & 31);
+    case 12: return fst << (snd & 31);
+    case 13: return fst > snd ? 1 : 0;
+    case 14: return fst < snd ? 1 : 0;
+    case 15: return fst == snd ? 1 : 0;
+    default: printf("[ERROR]\nInvalid interaction."); return 0;
+  }
+}
+
+void unary_operation(Net *net, u32 a_addr, u32 fst) {
+  u32 kind = get_kind(net, a_addr);
+  u32 snd = numb_of(get_port(net, a_addr, 1));
+  u64 dst = get_port(net, a_addr, 2);
+  COUNT_RULE(net, RULE_UNARY_OPERATION);
+  COUNT_UNARY(net, kind);
+  link_ports(net, dst, Numeric(apply_op(kind, fst, snd)));
+  free_node(net, a_addr);
+}
+
+// BinaryOperation
+void binary_operation_wired(Net *net, u32 a_addr, u32 fst) {
+  set_type(net, a_addr, OP1);
+  link_ports(net, Pointer(a_addr, 0), enter_port(net, Pointer(a_addr, 1)));
+  unlink_port(net, Pointer(a_addr, 1));
+  link_ports(net, Pointer(a_addr, 1), Numeric(fst));
+}
+
+void binary_operation(Net *net, u32 a_addr, u32 fst) {
+  COUNT_RULE(net, RULE_BINARY_OPERATION);
+  u64 snd = get_port(net, a_addr, 1);
+  if (is_wired(snd, a_addr, a_addr)) return binary_operation_wired(net, a_addr, fst);
+  write_node(net, a_addr, snd, Numeric(fst), get_port(net, a_addr, 2), OP1, get_kind(net, a_addr));
+  attach(net, Pointer(a_addr, 0), snd);
+}
+
+// NumberDuplication
+void number_duplication(Net *net, u32 a_addr, u32 numb) {
+  COUNT_RULE(net, RULE_NUMBER_DUPLICATION);
+  link_ports(net, Numeric(numb), get_port(net, a_addr, 1));
+  link_ports(net, Numeric(numb), get_port(net, a_addr, 2));
+  free_node(net, a_addr);
+}
+
+// IfThenElse
+void if_then_else(Net *net, u32 a_addr, u32 numb) {
+  COUNT_RULE(net, RULE_IF_THEN_ELSE);
+  u32 cond_val = numb == 0;
+  u64 pair_ptr = enter_port(net, Pointer(a_addr, 1));
+  set_type(net, a_addr, NOD);
+  link_ports(net, Pointer(a_addr, 0), pair_ptr);
+  unlink_port(net, Pointer(a_addr, 1));
+  u64 dest_ptr = enter_port(net, Pointer(a_addr, 2));
+  link_ports(net, Pointer(a_addr, cond_val ? 2 : 1), dest_ptr);
+  if (!cond_val) unlink_port(net, Pointer(a_addr, 2));
+  link_ports(net, Pointer(a_addr, cond_val ? 1 : 2), Pointer(a_addr, cond_val ? 1 : 2));
+}
+
+// Unlinks and frees both nodes of a pair
+void erase_pair(Net *net, u32 a_addr, u32 b_addr) {
+  for (u32 i = 0; i < 3; i++) {
+    unlink_port(net, Pointer(a_addr, i));
+    unlink_port(net, Pointer(b_addr, i));
+  }
+  free_node(net, a_addr);
+  if (a_addr != b_addr) {
+    free_node(net, b_addr);
+  }
+}
+
+// NodeAnnihilation, UnaryAnnihilation, BinaryAnnihilation
+void annihilation_wired(Net *net, u32 a_addr, u32 b_addr) {
+  u64 a_aux1_dest = enter_port(net, Pointer(a_addr, 1));
+  u64 b_aux1_dest = enter_port(net, Pointer(b_addr, 1));
+  link_ports(net, a_aux1_dest, b_aux1_dest);
+  u64 a_aux2_dest = enter_port(net, Pointer(a_addr, 2));
+  u64 b_aux2_dest = enter_port(net, Pointer(b_addr, 2));
+  link_ports(net, a_aux2_dest, b_aux2_dest);
+  erase_pair(net, a_addr, b_addr);
+}
+
+void annihilation(Net *net, u32 a_addr, u32 b_addr) {
+  COUNT_RULE(net, RULE_ANNIHILATION);
+  u64 a1 = get_port(net, a_addr, 1);
+  u64 a2 = get_port(net, a_addr, 2);
+  u64 b1 = get_port(net, b_addr, 1);
+  u64 b2 = get_port(net, b_addr, 2);
+  if (a_addr == b_addr || is_wired(a1, a_addr, b_addr) || is_wired(a2, a_addr, b_addr)
+    || is_wired(b1, a_addr, b_addr) || is_wired(b2, a_addr, b_addr)) {
+    return annihilation_wired(net, a_addr, b_addr);
+  }
+  link_ports(net, a1, b1);
+  link_ports(net, a2, b2);
+  free_node(net, a_addr);
+  free_node(net, b_addr);
+}
+
+// NodeDuplication, BinaryDuplication
+void duplication_wired(Net *net, u32 a_addr, u32 b_addr) {
+  u32 a_type = get_type(net, a_addr);
+  u32 b_type = get_type(net, b_addr);
+  u32 a_kind = get_kind(net, a_addr);
+  u32 b_kind = get_kind(net, b_addr);
+  u32 p_addr = alloc_node(net, b_type, b_kind);
+  u32 q_addr = alloc_node(net, b_type, b_kind);
+  u32 r_addr = alloc_node(net, a_type, a_kind);
+  u32 s_addr = alloc_node(net, a_type, a_kind);
+  link_ports(net, Pointer(r_addr, 1), Pointer(p_addr, 1));
+  link_ports(net, Pointer(s_addr, 1), Pointer(p_addr, 2));
+  link_ports(net, Pointer(r_addr, 2), Pointer(q_addr, 1));
+  link_ports(net, Pointer(s_addr, 2), Pointer(q_addr, 2));
+  link_ports(net, Pointer(p_addr, 0), enter_port(net, Pointer(a_addr, 1)));
+  link_ports(net, Pointer(q_addr, 0), enter_port(net, Pointer(a_addr, 2)));
+  link_ports(net, Pointer(r_addr, 0), enter_port(net, Pointer(b_addr, 1)));
+  link_ports(net, Pointer(s_addr, 0), enter_port(net, Pointer(b_addr, 2)));
+  erase_pair(net, a_addr, b_addr);
+}
+
+// Uncounted, so permutations are counted under their own rule only
+void duplicate(Net *net, u32 a_addr, u32 b_addr) {
+  u64 a1 = get_port(net, a_addr, 1);
+  u64 a2 = get_port(net, a_addr, 2);
+  u64 b1 = get_port(net, b_addr, 1);
+  u64 b2 = get_port(net, b_addr, 2);
+  if (is_wired(a1, a_addr, b_addr) || is_wired(a2, a_addr, b_addr)
+    || is_wired(b1, a_addr, b_addr) || is_wired(b2, a_addr, b_addr)) {
+    return duplication_wired(net, a_addr, b_addr);
+  }
+  u32 a_type = get_type(net, a_addr);
+  u32 b_type = get_type(net, b_addr);
+  u32 a_kind = get_kind(net, a_addr);
+  u32 b_kind = get_kind(net, b_addr);
+  u32 p_addr = alloc_addr(net);
+  u32 q_addr = alloc_addr(net);
+  u32 r_addr = alloc_addr(net);
+  u32 s_addr = alloc_addr(net);
+  write_node(net, p_addr, a1, Pointer(r_addr, 1), Pointer(s_addr, 1), b_type, b_kind);
+  write_node(net, q_addr, a2, Pointer(r_addr, 2), Pointer(s_addr, 2), b_type, b_kind);
+  write_node(net, r_addr, b1, Pointer(p_addr, 1), Pointer(q_addr, 1), a_type, a_kind);
+  write_node(net, s_addr, b2, Pointer(p_addr, 2), Pointer(q_addr, 2), a_type, a_kind);
+  attach(net, Pointer(p_addr, 0), a1);
+  attach(net, Pointer(q_addr, 0), a2);
+  attach(net, Pointer(r_addr, 0), b1);
+  attach(net, Pointer(s_addr, 0), b2);
+  free_node(net, a_addr);
+  free_node(net, b_addr);
+}
+
+void duplication(Net *net, u32 a_addr, u32 b_addr) {
+  COUNT_RULE(net, RULE_NODE_DUPLICATION);
+  duplicate(net, a_addr, b_addr);
+}
+
+// UnaryDuplication
+void unary_duplication_wired(Net *net, u32 a_addr, u32 b_addr) {
+  u32 a_type = get_type(net, a_addr);
+  u32 b_type = get_type(net, b_addr);
+  u32 a_kind = get_kind(net, a_addr);
+  u32 b_kind = get_kind(net, b_addr);
+  u32 p_addr = alloc_node(net, b_type, b_kind);
+  u32 q_addr = alloc_node(net, b_type, b_kind);
+  u32 s_addr = alloc_node(net, a_type, a_kind);
+  link_ports(net, Pointer(p_addr, 1), enter_port(net, Pointer(b_addr, 1)));
+  link_ports(net, Pointer(q_addr, 1), enter_port(net, Pointer(b_addr, 1)));
+  link_ports(net, Pointer(s_addr, 1), Pointer(p_addr, 2));
+  link_ports(net, Pointer(s_addr, 2), Pointer(q_addr, 2));
+  link_ports(net, Pointer(p_addr, 0), enter_port(net, Pointer(a_addr, 1)));
+  link_ports(net, Pointer(q_addr, 0), enter_port(net, Pointer(a_addr, 2)));
+  link_ports(net, Pointer(s_addr, 0), enter_port(net, Pointer(b_addr, 2)));
+  erase_pair(net, a_addr, b_addr);
+}
+
+void unary_duplicate(Net *net, u32 a_addr, u32 b_addr) {
+  u64 a1 = get_port(net, a_addr, 1);
+  u64 a2 = get_port(net, a_addr, 2);
+  u64 b1 = get_port(net, b_addr, 1);
+  u64 b2 = get_port(net, b_addr, 2);
+  if (type_of(b1) == PTR || is_wired(a1, a_addr, b_addr)
+    || is_wired(a2, a_addr, b_addr) || is_wired(b2, a_addr, b_addr)) {
+    return unary_duplication_wired(net, a_addr, b_addr);
+  }
+  u32 a_type = get_type(net, a_addr);
+  u32 a_kind = get_kind(net, a_addr);
+  u32 b_kind = get_kind(net, b_addr);
+  u32 p_addr = alloc_addr(net);
+  u32 q_addr = alloc_addr(net);
+  u32 s_addr = alloc_addr(net);
+  write_node(net, p_addr, a1, b1, Pointer(s_addr, 1), OP1, b_kind);
+  write_node(net, q_addr, a2, b1, Pointer(s_addr, 2), OP1, b_kind);
+  write_node(net, s_addr, b2, Pointer(p_addr, 2), Pointer(q_addr, 2), a_type, a_kind);
+  attach(net, Pointer(p_addr, 0), a1);
+  attach(net, Pointer(q_addr, 0), a2);
+  attach(net, Pointer(s_addr, 0), b2);
+  free_node(net, a_addr);
+  free_node(net, b_addr);
+}
+
+void unary_duplication(Net *net, u32 a_addr, u32 b_addr) {
+  COUNT_RULE(net, RULE_UNARY_DUPLICATION);
+  unary_duplicate(net, a_addr, b_addr);
+}
+
+// NOD against NOD annihilates when kinds match and duplicates otherwise
+void nod_nod(Net *net, u32 a_addr, u32 b_addr) {
+  if (get_kind(net, a_addr) == get_kind(net, b_addr)) {
+    annihilation(net, a_addr, b_addr);
+  } else {
+    duplication(net, a_addr, b_addr);
+  }
+}
+
+// Permutations: the same rules with the pair swapped
+void duplication_swapped(Net *net, u32 a_addr, u32 b_addr) {
+  COUNT_RULE(net, RULE_PERMUTATION);
+  duplicate(net, b_addr, a_addr);
+}
+
+void unary_duplication_swapped(Net *net, u32 a_addr, u32 b_addr) {
+  COUNT_RULE(net, RULE_PERMUTATION);
+  unary_duplicate(net, b_addr, a_addr);
+}
+
+// Indexed by [numeric][a_type][b_type]; b_type is 0 for numeric pairs.
+// Entries left NULL are invalid interactions.
+static const Rule rules[2][8][8] = {
+  [0][0][0] = nod_nod,
+  [0][0][2] = duplication,
+  [0][0][3] = duplication,
+  [0][0][1] = unary_duplication,
+  [0][3][1] = unary_duplication,
+  [0][1][1] = annihilation,
+  [0][2][2] = annihilation,
+  [0][3][3] = annihilation,
+  [0][1][0] = unary_duplication_swapped,
+  [0][2][0] = duplication_swapped,
+  [0][3][0] = duplication_swapped,
+  [1][0][0] = number_duplication,
+  [1][1][0] = unary_operation,
+  [1][2][0] = binary_operation,
+  [1][3][0] = if_then_else,
+};
+
 // Rewrites an active pair
 void rewrite(Net* net, u32 a_addr) {
   u64 b_ptrn = get_port(net, a_addr, 0);
+  u32 numeric = type_of(b_ptrn);
+  u32 b_type = numeric ? 0 : get_type(net, addr_of(b_ptrn));
+  Rule rule = rules[numeric][get_type(net, a_addr)][b_type];
+  if (!rule) rule = invalid_rule;
+  rule(net, a_addr, numeric ? numb_of(b_ptrn) : addr_of(b_ptrn));
+}
 
-  if (type_of(b_ptrn) == NUM) {
-    u32 a_type = get_type(net, a_addr);
-    u32 a_kind = get_kind(net, a_addr);
-
-    // UnaryOperation
-    if (a_type == OP1) {
-      u64 dst = enter_port(net, Pointer(a_addr, 2));
-      u32 fst = numb_of(b_ptrn);
-      u32 snd = numb_of(enter_port(net, Pointer(a_addr, 1)));
-      u64 res;
-      switch (a_kind) {
-        case  0: res = Numeric(fst + snd); break;
-        case  1: res = Numeric(fst - snd); break;
-        case  2: res = Numeric(fst * snd); break;
-        case  3: res = Numeric(fst / snd); break;
-        case  4: res = Numeric(fst % snd); break;
-        case  5: res = Numeric((u32)(pow((float)fst, (float)snd))); break;
-        case  6: res = Numeric((u32)(pow((float)fst, ((float)snd / pow(2.0,32.0))))); break;
-        case  7: res = Numeric(fst & snd); break;
-        case  8: res = Numeric(fst | snd); break;
-        case  9: res = Numeric(fst ^ snd); break;
-        case 10: res = Numeric(~snd); break;
-        case 11: res = Numeric(fst >> snd); break;
-        case 12: res = Numeric(fst << snd); break;
-        case 13: res = Numeric(fst > snd ? 1 : 0); break;
-        case 14: res = Numeric(fst < snd ? 1 : 0); break;
-        case 15: res = Numeric(fst == snd ? 1 : 0); break;
-        default: res = 0; printf("[ERROR]\nInvalid interaction."); break;
-      }
-      link_ports(net, dst, res);
-      unlink_port(net, Pointer(a_addr, 0));
-      unlink_port(net, Pointer(a_addr, 2));
-      free_node(net, a_addr);
-    
-    // BinaryOperation
-    } else if (a_type == OP2) {
-      set_type(net, a_addr, OP1);
-      link_ports(net, Pointer(a_addr, 0), enter_port(net, Pointer(a_addr, 1)));
-      unlink_port(net, Pointer(a_addr, 1));
-      link_ports(net, Pointer(a_addr, 1), b_ptrn);
-  
-    // NumberDuplication
-    } else if (a_type == NOD) {
-      link_ports(net, b_ptrn, enter_port(net, Pointer(a_addr, 1)));
-      link_ports(net, b_ptrn, enter_port(net, Pointer(a_addr, 2)));
-      free_node(net, a_addr);
-
-    // IfThenElse
-    } else if (a_type == ITE) {
-      u32 cond_val = numb_of(b_ptrn) == 0;
-      u64 pair_ptr = enter_port(net, Pointer(a_addr, 1));
-      set_type(net, a_addr, NOD);
-      link_ports(net, Pointer(a_addr, 0), pair_ptr);
-      unlink_port(net, Pointer(a_addr, 1));
-      u64 dest_ptr = enter_port(net, Pointer(a_addr, 2));
-      link_ports(net, Pointer(a_addr, cond_val ? 2 : 1), dest_ptr);
-        if (!cond_val) unlink_port(net, Pointer(a_addr, 2));
-      link_ports(net, Pointer(a_addr, cond_val ? 1 : 2), Pointer(a_addr, cond_val ? 1 : 2));
+// Scanning
+// ========
+// Whole-net passes classify nodes into bitmaps, 64 nodes per word. A node is
+// free if its ports point to themselves and its info word is clear. It starts
+// a redex if its principal port holds a number, or faces a principal port no
+// lower than its own, so each pair is found once. The AVX2 and SSE2 kernels
+// transpose 8 or 4 nodes so each word of a node sits in its own register and
+// test them together; other targets and the wide layout test one node at a
+// time. Nets over SCAN_GRAIN nodes per core are split across threads in runs
+// of whole words, so the bitmaps, and the redex order read from them, don't
+// depend on the thread count.
 
-    } else {
-      printf("[ERROR]\nInvalid interaction.");
-    }
+#define SCAN_GRAIN (1 << 20)
+#define SCAN_THREADS 64
 
-  } else {
-    u32 b_addr = addr_of(b_ptrn);
-    u32 a_type = get_type(net, a_addr);
-    u32 b_type = get_type(net, b_addr);
-    u32 a_kind = get_kind(net, a_addr);
-    u32 b_kind = get_kind(net, b_addr);
-
-    // NodeAnnihilation, UnaryAnnihilation, BinaryAnnihilation
-    if ( (a_type == NOD && b_type == NOD && a_kind == b_kind)
-      || (a_type == OP1 && b_type == OP1)
-      || (a_type == OP2 && b_type == OP2)
-      || (a_type == ITE && b_type == ITE)) {
-      u64 a_aux1_dest = enter_port(net, Pointer(a_addr, 1));
-      u64 b_aux1_dest = enter_port(net, Pointer(b_addr, 1));
-      link_ports(net, a_aux1_dest, b_aux1_dest);
-      u64 a_aux2_dest = enter_port(net, Pointer(a_addr, 2));
-      u64 b_aux2_dest = enter_port(net, Pointer(b_addr, 2));
-      link_ports(net, a_aux2_dest, b_aux2_dest);
-      for (u32 i = 0; i < 3; i++) {
-        unlink_port(net, Pointer(a_addr, i));
-        unlink_port(net, Pointer(b_addr, i));
-      }
-      free_node(net, a_addr);
-      if (a_addr != b_addr) {
-        free_node(net, b_addr);
-      }
+// Classifies the `len` (at most 64) nodes from `addr`, one bit per node
+void scan_block(Net *net, u32 addr, u32 len, u64 *free_bits, u64 *redex_bits) {
+  u64 free_mask = 0;
+  u64 redex_mask = 0;
+  u32 i = 0;
+  #if !defined(FM_WIDE_PORTS) && defined(__AVX2__)
+  // Lanes hold nodes 0 2 4 6 | 1 3 5 7 after the transpose
+  const __m256i order = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+  const __m256i unscramble = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i two = _mm256_set1_epi32(2);
+  const __m256i three = _mm256_set1_epi32(3);
+  for (; i + 8 <= len; i += 8) {
+    const __m256i *src = (const __m256i*)(net->nodes + (u64)(addr + i) * 4);
+    __m256i n01 = _mm256_loadu_si256(src + 0);
+    __m256i n23 = _mm256_loadu_si256(src + 1);
+    __m256i n45 = _mm256_loadu_si256(src + 2);
+    __m256i n67 = _mm256_loadu_si256(src + 3);
+    __m256i lo_a = _mm256_unpacklo_epi32(n01, n23);
+    __m256i hi_a = _mm256_unpackhi_epi32(n01, n23);
+    __m256i lo_b = _mm256_unpacklo_epi32(n45, n67);
+    __m256i hi_b = _mm256_unpackhi_epi32(n45, n67);
+    __m256i port0 = _mm256_unpacklo_epi64(lo_a, lo_b);
+    __m256i port1 = _mm256_unpackhi_epi64(lo_a, lo_b);
+    __m256i port2 = _mm256_unpacklo_epi64(hi_a, hi_b);
+    __m256i info = _mm256_unpackhi_epi64(hi_a, hi_b);
+    __m256i self = _mm256_slli_epi32(_mm256_add_epi32(_mm256_set1_epi32(addr + i), order), 2);
+    __m256i is_free = _mm256_and_si256(
+      _mm256_and_si256(_mm256_cmpeq_epi32(port0, self), _mm256_cmpeq_epi32(port1, _mm256_add_epi32(self, one))),
+      _mm256_and_si256(_mm256_cmpeq_epi32(port2, _mm256_add_epi32(self, two)), _mm256_cmpeq_epi32(info, zero)));
+    __m256i numeric = _mm256_cmpeq_epi32(_mm256_and_si256(info, one), one);
+    __m256i main = _mm256_cmpeq_epi32(_mm256_and_si256(port0, three), zero);
+    __m256i upward = _mm256_cmpeq_epi32(_mm256_max_epu32(port0, self), port0);
+    __m256i is_redex = _mm256_or_si256(numeric, _mm256_andnot_si256(is_free, _mm256_and_si256(main, upward)));
+    is_free = _mm256_permutevar8x32_epi32(is_free, unscramble);
+    is_redex = _mm256_permutevar8x32_epi32(is_redex, unscramble);
+    free_mask |= (u64)_mm256_movemask_ps(_mm256_castsi256_ps(is_free)) << i;
+    redex_mask |= (u64)_mm256_movemask_ps(_mm256_castsi256_ps(is_redex)) << i;
+  }
+  #elif !defined(FM_WIDE_PORTS) && defined(__SSE2__)
+  const __m128i order = _mm_setr_epi32(0, 1, 2, 3);
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi32(1);
+  const __m128i two = _mm_set1_epi32(2);
+  const __m128i three = _mm_set1_epi32(3);
+  const __m128i sign = _mm_set1_epi32((int)0x80000000);
+  for (; i + 4 <= len; i += 4) {
+    const __m128i *src = (const __m128i*)(net->nodes + (u64)(addr + i) * 4);
+    __m128i n0 = _mm_loadu_si128(src + 0);
+    __m128i n1 = _mm_loadu_si128(src + 1);
+    __m128i n2 = _mm_loadu_si128(src + 2);
+    __m128i n3 = _mm_loadu_si128(src + 3);
+    __m128i lo_a = _mm_unpacklo_epi32(n0, n1);
+    __m128i hi_a = _mm_unpackhi_epi32(n0, n1);
+    __m128i lo_b = _mm_unpacklo_epi32(n2, n3);
+    __m128i hi_b = _mm_unpackhi_epi32(n2, n3);
+    __m128i port0 = _mm_unpacklo_epi64(lo_a, lo_b);
+    __m128i port1 = _mm_unpackhi_epi64(lo_a, lo_b);
+    __m128i port2 = _mm_unpacklo_epi64(hi_a, hi_b);
+    __m128i info = _mm_unpackhi_epi64(hi_a, hi_b);
+    __m128i self = _mm_slli_epi32(_mm_add_epi32(_mm_set1_epi32((int)(addr + i)), order), 2);
+    __m128i is_free = _mm_and_si128(
+      _mm_and_si128(_mm_cmpeq_epi32(port0, self), _mm_cmpeq_epi32(port1, _mm_add_epi32(self, one))),
+      _mm_and_si128(_mm_cmpeq_epi32(port2, _mm_add_epi32(self, two)), _mm_cmpeq_epi32(info, zero)));
+    __m128i numeric = _mm_cmpeq_epi32(_mm_and_si128(info, one), one);
+    __m128i main = _mm_cmpeq_epi32(_mm_and_si128(port0, three), zero);
+    __m128i downward = _mm_cmpgt_epi32(_mm_xor_si128(self, sign), _mm_xor_si128(port0, sign));
+    __m128i is_redex = _mm_or_si128(numeric, _mm_andnot_si128(_mm_or_si128(is_free, downward), main));
+    free_mask |= (u64)_mm_movemask_ps(_mm_castsi128_ps(is_free)) << i;
+    redex_mask |= (u64)_mm_movemask_ps(_mm_castsi128_ps(is_redex)) << i;
+  }
+  #endif
+  for (; i < len; ++i) {
+    u64 b_ptrn = get_port(net, addr + i, 0);
+    if (is_free(net, addr + i)) {
+      free_mask |= (u64)1 << i;
+    } else if (type_of(b_ptrn) == NUM || (slot_of(b_ptrn) == 0 && addr_of(b_ptrn) >= addr + i)) {
+      redex_mask |= (u64)1 << i;
+    }
+  }
+  if (free_bits) *free_bits = free_mask;
+  if (redex_bits) *redex_bits = redex_mask;
+}
 
-    // NodeDuplication, BinaryDuplication
-    } else if
-      (  (a_type == NOD && b_type == NOD && a_kind != b_kind)
-      || (a_type == NOD && b_type == OP2)
-      || (a_type == NOD && b_type == ITE)) {
-      u32 p_addr = alloc_node(net, b_type, b_kind);
-      u32 q_addr = alloc_node(net, b_type, b_kind);
-      u32 r_addr = alloc_node(net, a_type, a_kind);
-      u32 s_addr = alloc_node(net, a_type, a_kind);
-      link_ports(net, Pointer(r_addr, 1), Pointer(p_addr, 1));
-      link_ports(net, Pointer(s_addr, 1), Pointer(p_addr, 2));
-      link_ports(net, Pointer(r_addr, 2), Pointer(q_addr, 1));
-      link_ports(net, Pointer(s_addr, 2), Pointer(q_addr, 2));
-      link_ports(net, Pointer(p_addr, 0), enter_port(net, Pointer(a_addr, 1)));
-      link_ports(net, Pointer(q_addr, 0), enter_port(net, Pointer(a_addr, 2)));
-      link_ports(net, Pointer(r_addr, 0), enter_port(net, Pointer(b_addr, 1)));
-      link_ports(net, Pointer(s_addr, 0), enter_port(net, Pointer(b_addr, 2)));
-      for (u32 i = 0; i < 3; i++) {
-        unlink_port(net, Pointer(a_addr, i));
-        unlink_port(net, Pointer(b_addr, i));
-      }
-      free_node(net, a_addr);
-      if (a_addr != b_addr) {
-        free_node(net, b_addr);
-      }
+typedef struct ScanJob {
+  Net *net;
+  u32 from;
+  u32 to;
+  u64 *free_bits;
+  u64 *redex_bits;
+  pthread_t thread;
+} ScanJob;
 
-    // UnaryDuplication
-    } else if
-      (  (a_type == NOD && b_type == OP1)
-      || (a_type == ITE && b_type == OP1)) {
-      u32 p_addr = alloc_node(net, b_type, b_kind);
-      u32 q_addr = alloc_node(net, b_type, b_kind);
-      u32 s_addr = alloc_node(net, a_type, a_kind);
-      link_ports(net, Pointer(p_addr, 1), enter_port(net, Pointer(b_addr, 1)));
-      link_ports(net, Pointer(q_addr, 1), enter_port(net, Pointer(b_addr, 1)));
-      link_ports(net, Pointer(s_addr, 1), Pointer(p_addr, 2));
-      link_ports(net, Pointer(s_addr, 2), Pointer(q_addr, 2));
-      link_ports(net, Pointer(p_addr, 0), enter_port(net, Pointer(a_addr, 1)));
-      link_ports(net, Pointer(q_addr, 0), enter_port(net, Pointer(a_addr, 2)));
-      link_ports(net, Pointer(s_addr, 0), enter_port(net, Pointer(b_addr, 2)));
-      for (u32 i = 0; i < 3; i++) {
-        unlink_port(net, Pointer(a_addr, i));
-        unlink_port(net, Pointer(b_addr, i));
-      }
-      free_node(net, a_addr);
-      if (a_addr != b_addr) {
-        free_node(net, b_addr);
-      }
-    
-    // Permutations
-    } else if (a_type == OP1 && b_type == NOD) {
-      return rewrite(net, b_addr);
-    } else if (a_type == OP2 && b_type == NOD) {
-      return rewrite(net, b_addr);
-    } else if (a_type == ITE && b_type == NOD) {
-      return rewrite(net, b_addr);
-
-    // InvalidInteraction
-    } else {
-      printf("[ERROR]\nInvalid interaction.");
-    }
+void *scan_range(void *arg) {
+  ScanJob *job = arg;
+  for (u32 addr = job->from; addr < job->to; addr += 64) {
+    u32 len = job->to - addr < 64 ? job->to - addr : 64;
+    scan_block(job->net, addr, len,
+      job->free_bits ? &job->free_bits[addr >> 6] : NULL,
+      job->redex_bits ? &job->redex_bits[addr >> 6] : NULL);
   }
+  return NULL;
 }
 
-// Rewrites active pairs until none is left, reducing the graph to normal form
-// This could be performed in parallel. Unreachable data is freed automatically.
-Stats reduce(Net *net) {
-  Stats stats;
-  stats.rewrites = 0;
-  stats.loops = 0;
-  while (net->redex_len > 0) {
-    for (u32 i = 0, l = net->redex_len; i < l; ++i) {
-      rewrite(net, net->redex[--net->redex_len]);
-      ++stats.rewrites;
+u32 scan_threads(u32 len) {
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  u32 threads = len / SCAN_GRAIN;
+  if (cpus > 0 && threads > (u32)cpus) threads = (u32)cpus;
+  if (threads > SCAN_THREADS) threads = SCAN_THREADS;
+  return threads < 1 ? 1 : threads;
+}
+
+// Fills a word of either bitmap, if given, for every 64 nodes of the net
+void scan_net(Net *net, u64 *free_bits, u64 *redex_bits) {
+  u32 len = net->nodes_len / 4;
+  u64 blocks = (len + 63) / 64;
+  u32 threads = scan_threads(len);
+  ScanJob jobs[SCAN_THREADS];
+  for (u32 t = 0; t < threads; ++t) {
+    u64 from = blocks * t / threads * 64;
+    u64 to = blocks * (t + 1) / threads * 64;
+    jobs[t].net = net;
+    jobs[t].from = (u32)from;
+    jobs[t].to = to < len ? (u32)to : len;
+    jobs[t].free_bits = free_bits;
+    jobs[t].redex_bits = redex_bits;
+    if (t > 0 && pthread_create(&jobs[t].thread, NULL, scan_range, &jobs[t]) != 0) {
+      scan_range(&jobs[t]);
+      jobs[t].net = NULL;
     }
-    ++stats.loops;
   }
-  return stats;
+  scan_range(&jobs[0]);
+  for (u32 t = 1; t < threads; ++t) {
+    if (jobs[t].net) pthread_join(jobs[t].thread, NULL);
+  }
 }
 
+// Queues every active pair of the net, in address order. A single thread
+// reads each word of the bitmap while it is still in cache instead.
 void find_redexes(Net *net) {
+  u32 len = net->nodes_len / 4;
+  u64 *bits = NULL;
+  if (scan_threads(len) > 1) {
+    bits = malloc(sizeof(u64) * ((len + 63) / 64));
+    if (!bits) out_of_memory("scan");
+    scan_net(net, NULL, bits);
+  }
   net->redex_len = 0;
-  for (u32 i = 0; i < net->nodes_len / 4; ++i) {
-    u64 b_ptrn = enter_port(net, Pointer(i, 0));
-    if ((type_of(b_ptrn) == NUM || addr_of(b_ptrn) >= i) && is_redex(net, i)) {
-      net->redex[net->redex_len++] = i;
+  for (u32 addr = 0; addr < len; addr += 64) {
+    u64 word;
+    if (bits) {
+      word = bits[addr >> 6];
+    } else {
+      scan_block(net, addr, len - addr < 64 ? len - addr : 64, NULL, &word);
+    }
+    while (net->redex_end - net->redex_len < 64) grow_stack(&net->redex_mem, &net->redex_end, "redex");
+    for (; word; word &= word - 1) {
+      net->redex[net->redex_len++] = addr + __builtin_ctzll(word);
     }
   }
+  free(bits);
 }
 
-void print_pointer(u64 ptrn) {
-  if (type_of(ptrn) == NUM) {
-    printf("#%u", numb_of(ptrn));
-  } else {
-    printf("%u", addr_of(ptrn));
-    switch (slot_of(ptrn)) {
-      case 0: printf("a"); break;
-      case 1: printf("b"); break;
-      case 2: printf("c"); break;
+// Compaction
+// ==========
+// Renumbers live nodes into a dense prefix of the node buffer, keeping their
+// order, then hands the pages past the new end back to the OS; they stay
+// committed and come back zeroed when the net grows again. The free list is
+// empty afterwards, so its buffer holds a live-node bitmap with a running
+// count per 64 nodes, from which each node's new address is computed.
+//
+// `reduce` compacts between rounds once more than `compact_at` nodes, and
+// half of the buffer, are free. Allocation itself stays LIFO: the nodes
+// a rewrite frees are the ones the next rewrite is most likely to find in
+// cache, which beat region-segregated free lists on every benchmark net.
+
+u32 moved_addr(u64 *bits, u32 *ranks, u32 addr) {
+  return ranks[addr >> 6] + __builtin_popcountll(bits[addr >> 6] & (((u64)1 << (addr & 63)) - 1));
+}
+
+void compact(Net *net) {
+  u32 len = net->nodes_len / 4;
+  u32 blocks = (len + 63) / 64;
+  if (!arena_commit(&net->freed_mem, (u64)blocks * (sizeof(u64) + sizeof(u32)))) out_of_memory("free list");
+  net->freed_end = (u32)(net->freed_mem.committed / 4);
+  u64 *bits = (u64*)net->freed_mem.base;
+  u32 *ranks = (u32*)(bits + blocks);
+
+  // Queued pairs are live even if they happen to look free
+  scan_net(net, bits, NULL);
+  for (u32 b = 0; b < blocks; ++b) {
+    bits[b] = ~bits[b];
+  }
+  if (len & 63) bits[blocks - 1] &= ((u64)1 << (len & 63)) - 1;
+  for (u32 i = 0; i < net->redex_len; ++i) {
+    bits[net->redex[i] >> 6] |= (u64)1 << (net->redex[i] & 63);
+  }
+  u32 live = 0;
+  for (u32 b = 0; b < blocks; ++b) {
+    ranks[b] = live;
+    live += __builtin_popcountll(bits[b]);
+  }
+
+  // Nodes only move down, so each lands on a slot that was already moved
+  for (u32 i = 0; i < len; ++i) {
+    if (!((bits[i >> 6] >> (i & 63)) & 1)) continue;
+    u64 port[3];
+    for (u32 slot = 0; slot < 3; ++slot) {
+      port[slot] = get_port(net, i, slot);
+      if (type_of(port[slot]) == PTR) {
+        port[slot] = Pointer(moved_addr(bits, ranks, addr_of(port[slot])), slot_of(port[slot]));
+      }
     }
+    write_node(net, moved_addr(bits, ranks, i), port[0], port[1], port[2], get_type(net, i), get_kind(net, i));
+  }
+  for (u32 i = 0; i < net->redex_len; ++i) {
+    net->redex[i] = moved_addr(bits, ranks, net->redex[i]);
+  }
+  if (net->nodes_len > net->nodes_peak) net->nodes_peak = net->nodes_len;
+  net->nodes_len = live * 4;
+  net->freed_len = 0;
+
+  u64 page = (u64)sysconf(_SC_PAGESIZE);
+  u64 used = ((u64)net->nodes_len * sizeof(Word) + page - 1) & ~(page - 1);
+  if (used < net->nodes_mem.committed) {
+    madvise(net->nodes_mem.base + used, net->nodes_mem.committed - used, MADV_DONTNEED);
   }
+  madvise(net->freed_mem.base, net->freed_mem.committed, MADV_DONTNEED);
 }
 
-void print_net(Net* net) {
-  for (u32 i = 0; i < net->nodes_len / 4; i++) {
-    if (is_free(net, i)) {
-      printf("%u: ~\n", i);
-    } else {
-      u32 type = get_type(net, i);
-      u32 kind = get_kind(net, i);
-      printf("%u: ", i);
-      printf("[%u:%u| ", type, kind);
-      print_pointer(get_port(net, i, 0));
-      printf(" ");
-      print_pointer(get_port(net, i, 1));
-      printf(" ");
-      print_pointer(get_port(net, i, 2));
-      printf("]");
-      printf("...");
-      printf("%d ", is_numeric(net, i, 0));
-      printf("%d ", is_numeric(net, i, 1));
-      printf("%d ", is_numeric(net, i, 2));
-      printf("\n");
+// Scheduling
+// ==========
+// By default each round pops the redex stack one pair at a time, so a rewrite
+// usually finds the nodes its predecessor just touched in cache. The other
+// policies trade that locality for an order known ahead of time: FIFO rounds
+// rewrite the whole stack bottom-up, one generation at a time, and sorted
+// rounds do the same in address order. With a prefetch distance `d`, the
+// pair `2d` ahead has its node prefetched, the one `d` ahead its partner and
+// neighbors, and the one `d/2` ahead its partner's neighbors, so those cache
+// misses overlap instead of stalling one after another. Under LIFO, "ahead"
+// means deeper in the stack; pairs a rewrite pushes are popped first and are
+// in cache anyway. Every policy reaches the same normal form with the same
+// number of rewrites; only `loops` differs.
+
+void prefetch_node(Net *net, u32 addr) {
+  __builtin_prefetch(&net->nodes[addr * 4], 1);
+}
+
+// Prefetches the nodes wired to `addr` from `slot` on; `addr` should be cached
+void prefetch_wires(Net *net, u32 addr, u32 slot) {
+  for (; slot < 3; ++slot) {
+    u64 ptrn = get_port(net, addr, slot);
+    if (type_of(ptrn) == PTR) prefetch_node(net, addr_of(ptrn));
+  }
+}
+
+// Prefetches for the pairs queued `dist`, `2 * dist` and `dist / 2` steps of
+// `step` past `queue`, of which only the next `left` exist
+void prefetch_redex(Net *net, u32 *queue, int step, u32 left, u32 dist) {
+  if (2 * dist <= left) prefetch_node(net, queue[step * (int)(2 * dist)]);
+  if (dist <= left) prefetch_wires(net, queue[step * (int)dist], 0);
+  if (dist / 2 <= left) {
+    u64 b_ptrn = get_port(net, queue[step * (int)(dist / 2)], 0);
+    if (type_of(b_ptrn) == PTR) prefetch_wires(net, addr_of(b_ptrn), 1);
+  }
+}
+
+// Sorts the first `len` queued pairs by address, using the stack past its top
+// as scratch. Radix passes skip any byte that is the same in every address.
+void sort_redexes(Net *net, u32 len) {
+  u32 *keys = net->redex;
+  if (len < 32) {
+    for (u32 i = 1; i < len; ++i) {
+      u32 key = keys[i];
+      u32 j = i;
+      for (; j > 0 && keys[j - 1] > key; --j) keys[j] = keys[j - 1];
+      keys[j] = key;
+    }
+    return;
+  }
+  while (net->redex_end - net->redex_len < len) grow_stack(&net->redex_mem, &net->redex_end, "redex");
+  u32 *tmp = keys + net->redex_len;
+  u32 count[4][256];
+  memset(count, 0, sizeof(count));
+  for (u32 i = 0; i < len; ++i) {
+    for (u32 d = 0; d < 4; ++d) count[d][(keys[i] >> (d * 8)) & 0xFF]++;
+  }
+  for (u32 d = 0; d < 4; ++d) {
+    if (count[d][(keys[0] >> (d * 8)) & 0xFF] == len) continue;
+    u32 sum = 0;
+    for (u32 k = 0; k < 256; ++k) {
+      u32 c = count[d][k];
+      count[d][k] = sum;
+      sum += c;
     }
+    for (u32 i = 0; i < len; ++i) {
+      tmp[count[d][(keys[i] >> (d * 8)) & 0xFF]++] = keys[i];
+    }
+    u32 *swap = keys;
+    keys = tmp;
+    tmp = swap;
   }
+  if (keys != net->redex) memcpy(net->redex, keys, sizeof(u32) * len);
 }
 
-// def keccak: {s} (bytes_to_hex (Keccak256 (to_chars s)))
-// def main: dup fn = (~512 #keccak) # (fn "")
-// Applies keccak256 1024 times to empty string
-static u32 nodes[] = {
-  2,8466,0,0,8,164,8464,0,4,24,156,0,40,21,18,0,25,22,14,0,26,13,17,0,9,16,20,64,56,37,34,0,41,38,30,0,42,29,33,0,12,32,36,64,72,53,50,0,57,54,46,0,58,45,49,0,28,48,52,64,88,69,66,0,73,70,62,0,74,61,65,0,44,64,68,64,104,85,82,0,89,86,78,0,90,77,81,0,60,80,84,64,120,101,98,0,105,102,94,0,106,93,97,0,76,96,100,64,136,117,114,0,121,118,110,0,122,109,113,0,92,112,116,64,152,133,130,0,137,134,126,0,138,125,129,0,108,128,132,64,160,149,146,0,153,150,142,0,154,141,145,0,124,144,148,64,10,161,162,0,140,157,158,0,5,8229,170,0,172,450,166,0,168,324,178,0,180,320,174,0,176,192,184,0,182,1954047348,188,4194242,186,316,284,0,181,196,296,0,193,221,200,0,198,256,204,0,202,217,208,0,206,280,234,0,222,218,272,528,8,205,213,721,24,197,212,785,3,230,264,977,4,281,225,273,238,254,210,0,265,240,232,4194264,237,246,248,4194240,317,273,241,0,242,250,249,0,258,278,233,0,201,262,252,0,266,268,257,4194264,226,236,260,4194240,261,0,274,4194242,214,245,270,4194240,1,282,253,17,209,229,277,4194240,190,309,290,0,294,0,286,2,298,0,288,2,194,300,292,0,297,313,304,0,302,305,310,0,314,285,306,0,318,301,308,0,189,244,312,128,177,392,440,0,173,328,444,0,325,436,332,0,330,385,338,0,342,386,334,0,393,346,336,0,348,382,341,0,344,376,354,0,358,360,350,4194264,10,369,352,913,353,366,374,4194240,48,370,361,17,377,357,365,4194240,87,378,362,17,349,368,373,4194240,16,437,345,209,390,333,337,0,394,398,384,0,321,340,388,128,400,434,389,0,396,428,406,0,410,412,402,4194264,10,421,404,913,405,418,426,4194240,48,422,413,17,429,409,417,4194240,87,430,414,17,401,420,425,4194240,16,438,397,273,329,381,433,4194240,322,445,446,0,326,441,442,0,452,8230,169,0,448,456,794,0,453,460,808,0,457,505,464,0,462,501,468,0,466,788,472,0,470,493,476,0,474,489,480,0,478,485,486,0,490,481,482,0,494,477,484,0,498,473,488,0,502,790,492,0,506,465,496,0,510,461,500,0,514,520,504,4194264,135,518,508,977,136,789,513,273,509,524,684,4194240,521,665,528,0,526,560,532,0,530,565,536,0,534,573,540,0,538,609,544,0,542,680,550,0,554,682,546,0,558,668,548,0,562,570,552,0,529,566,556,0,1,533,561,17,681,574,557,0,578,537,569,0,580,610,572,0,576,600,584,0,582,592,588,0,586,601,594,0,585,598,590,0,602,604,593,0,581,589,596,0,597,606,605,0,614,541,577,0,616,660,608,0,612,656,620,0,618,636,624,0,622,637,628,0,626,648,634,0,638,640,630,0,621,625,632,0,633,652,644,0,642,657,650,0,629,654,646,0,641,658,649,0,617,645,653,0,613,664,666,0,661,525,662,592,553,677,672,0,670,676,678,0,673,669,674,0,545,568,549,192,522,785,688,0,686,720,692,0,690,725,696,0,694,717,700,0,698,729,704,0,702,709,710,0,714,705,706,0,718,730,708,0,722,697,712,0,689,726,716,0,1,693,721,17,734,701,713,0,736,780,728,0,732,776,740,0,738,756,744,0,742,757,748,0,746,768,754,0,758,760,750,0,741,745,752,0,753,772,764,0,762,777,770,0,749,774,766,0,761,778,769,0,737,765,773,0,733,784,786,0,781,685,782,592,469,517,497,4194240,798,3620,454,0,802,3608,792,0,806,3394,796,0,810,0,800,2,458,812,804,0,809,813,816,0,814,829,820,0,818,865,824,0,822,1168,1174,0,834,817,1160,0,836,866,828,0,832,856,840,0,838,848,844,0,842,857,850,0,841,854,846,0,858,860,849,0,837,845,852,0,853,862,861,0,870,821,833,0,872,916,864,0,868,912,876,0,874,892,880,0,878,893,884,0,882,904,890,0,894,896,886,0,877,881,888,0,889,908,900,0,898,913,906,0,885,910,902,0,897,914,905,0,873,901,909,0,869,921,922,0,1,917,918,593,930,1152,1164,0,934,1132,924,0,938,1116,928,0,940,968,932,0,936,956,944,0,942,965,948,0,946,957,952,0,950,960,962,0,941,949,964,0,953,966,954,0,958,945,961,0,937,1092,1084,0,1100,981,978,0,985,982,974,0,986,973,977,0,1093,976,980,192,1108,997,994,0,1001,998,990,0,1002,989,993,0,1101,992,996,192,1032,1013,1010,0,1017,1014,1006,0,1018,1005,1009,0,1109,1008,1012,192,1048,1029,1026,0,1033,1030,1022,0,1034,1021,1025,0,1004,1024,1028,192,1064,1045,1042,0,1049,1046,1038,0,1050,1037,1041,0,1020,1040,1044,192,1080,1061,1058,0,1065,1062,1054,0,1066,1053,1057,0,1036,1056,1060,192,1112,1077,1074,0,1081,1078,1070,0,1082,1069,1073,0,1052,1072,1076,192,970,1113,1090,0,1094,1098,1086,0,969,984,1088,192,1102,1106,1089,0,972,1000,1096,192,1110,1114,1097,0,988,1016,1104,192,1068,1085,1105,0,933,1124,1120,0,1118,1129,1126,0,1117,1130,1122,0,128,1121,1125,593,929,1144,1136,0,1134,1148,1140,0,1138,1149,1146,0,1133,1150,1142,0,1137,1141,1145,0,925,1154,1153,0,1169,1165,1162,0,830,1166,1158,0,926,1157,1161,0,825,1156,1172,0,1170,1176,826,0,1173,1981,1180,0,1178,2025,1184,0,1182,2069,1188,0,1186,2113,1192,0,1190,2157,1196,0,1194,2201,1200,0,1198,2245,1204,0,1202,2289,1208,0,1206,2333,1212,0,1210,2377,1216,0,1214,2421,1220,0,1218,2465,1224,0,1222,2509,1228,0,1226,2553,1232,0,1230,2597,1236,0,1234,2641,1240,0,1238,2685,1244,0,1242,2729,1248,0,1246,2773,1252,0,1250,2817,1256,0,1254,2861,1260,0,1258,2905,1264,0,1262,2949,1268,0,1266,2993,1272,0,1270,3037,1276,0,1274,3081,1280,0,1278,3125,1284,0,1282,3169,1288,0,1286,3213,1292,0,1290,3257,1296,0,1294,3301,1300,0,1298,3345,1304,0,1302,1305,1308,0,1306,1309,1312,0,1310,1313,1316,0,1314,1317,1320,0,1318,1321,1324,0,1322,1325,1328,0,1326,1329,1332,0,1330,1333,1336,0,1334,1337,1340,0,1338,1341,1344,0,1342,1345,1348,0,1346,1349,1352,0,1350,1353,1356,0,1354,1357,1360,0,1358,1361,1364,0,1362,1365,1368,0,1366,1369,1372,0,1370,1373,1376,0,1374,1377,1380,0,1378,1381,1384,0,1382,1385,1388,0,1386,1389,1392,0,1390,1393,1396,0,1394,1397,1400,0,1398,1401,1404,0,1402,1405,1408,0,1406,1409,1412,0,1410,1413,1416,0,1414,1417,1420,0,1418,1421,1424,0,1422,1425,1428,0,1426,1429,1432,0,1430,1433,1436,0,1434,1437,1440,0,1438,1441,1444,0,1442,1445,1448,0,1446,1449,1452,0,1450,1453,1456,0,1454,1457,1460,0,1458,1461,1464,0,1462,1465,1468,0,1466,1469,1472,0,1470,1473,1476,0,1474,1477,1480,0,1478,1481,1484,0,1482,1485,1488,0,1486,1489,1492,0,1490,1493,1496,0,1494,1497,1500,0,1498,1501,1504,0,1502,1505,1508,0,1506,1509,1512,0,1510,1513,1516,0,1514,1517,1520,0,1518,1521,1524,0,1522,1525,1528,0,1526,1529,1532,0,1530,1533,1536,0,1534,1537,1540,0,1538,1541,1544,0,1542,1545,1548,0,1546,1549,1552,0,1550,1553,1556,0,1554,1557,1560,0,1558,1561,1564,0,1562,1565,1568,0,1566,1569,1572,0,1570,1573,1576,0,1574,1577,1580,0,1578,1581,1584,0,1582,1585,1588,0,1586,1589,1592,0,1590,1593,1596,0,1594,1597,1600,0,1598,1601,1604,0,1602,1605,1608,0,1606,1609,1612,0,1610,1613,1616,0,1614,1617,1620,0,1618,1621,1624,0,1622,1625,1628,0,1626,1629,1632,0,1630,1633,1636,0,1634,1637,1640,0,1638,1641,1644,0,1642,1645,1648,0,1646,1649,1652,0,1650,1653,1656,0,1654,1657,1660,0,1658,1661,1664,0,1662,1665,1668,0,1666,1669,1672,0,1670,1673,1676,0,1674,1677,1680,0,1678,1681,1684,0,1682,1685,1688,0,1686,1689,1692,0,1690,1693,1696,0,1694,1697,1700,0,1698,1701,1704,0,1702,1705,1708,0,1706,1709,1712,0,1710,1713,1716,0,1714,1717,1720,0,1718,1721,1724,0,1722,1725,1728,0,1726,1729,1732,0,1730,1733,1736,0,1734,1737,1740,0,1738,1741,1744,0,1742,1745,1748,0,1746,1749,1752,0,1750,1753,1756,0,1754,1757,1760,0,1758,1761,1764,0,1762,1765,1768,0,1766,1769,1772,0,1770,1773,1776,0,1774,1777,1780,0,1778,1781,1784,0,1782,1785,1788,0,1786,1789,1792,0,1790,1793,1796,0,1794,1797,1800,0,1798,1801,1804,0,1802,1805,1808,0,1806,1809,1812,0,1810,1813,1816,0,1814,1817,1820,0,1818,1821,1824,0,1822,1825,1828,0,1826,1829,1832,0,1830,1833,1836,0,1834,1837,1840,0,1838,1841,1844,0,1842,1845,1848,0,1846,1849,1852,0,1850,1853,1856,0,1854,1857,1860,0,1858,1861,1864,0,1862,1865,1868,0,1866,1869,1872,0,1870,1873,1876,0,1874,1877,1880,0,1878,1881,1884,0,1882,1885,1888,0,1886,1889,1892,0,1890,1893,1896,0,1894,1897,1900,0,1898,1901,1904,0,1902,1905,1908,0,1906,1909,1912,0,1910,1913,1916,0,1914,1917,1920,0,1918,1921,1924,0,1922,1925,1928,0,1926,1929,1932,0,1930,1933,1936,0,1934,1937,1940,0,1938,1941,1944,0,1942,1945,1948,0,1946,1949,1952,0,1950,1953,1956,0,1954,1957,1960,0,1958,1961,1964,0,1962,1965,1968,0,1966,1969,1972,0,1970,1973,1978,0,1982,2022,1974,0,1984,1177,1976,0,1980,2009,1988,0,1986,1996,1992,0,1990,2012,2000,0,1989,2013,2016,0,1994,2017,2006,0,2010,2018,2002,0,2014,1985,2004,0,1993,1997,2008,256,1998,2001,2005,0,2026,2066,1977,0,2028,1181,2020,0,2024,2053,2032,0,2030,2040,2036,0,2034,2056,2044,0,2033,2057,2060,0,2038,2061,2050,0,2054,2062,2046,0,2058,2029,2048,0,2037,2041,2052,256,2042,2045,2049,0,2070,2110,2021,0,2072,1185,2064,0,2068,2097,2076,0,2074,2084,2080,0,2078,2100,2088,0,2077,2101,2104,0,2082,2105,2094,0,2098,2106,2090,0,2102,2073,2092,0,2081,2085,2096,256,2086,2089,2093,0,2114,2154,2065,0,2116,1189,2108,0,2112,2141,2120,0,2118,2128,2124,0,2122,2144,2132,0,2121,2145,2148,0,2126,2149,2138,0,2142,2150,2134,0,2146,2117,2136,0,2125,2129,2140,256,2130,2133,2137,0,2158,2198,2109,0,2160,1193,2152,0,2156,2185,2164,0,2162,2172,2168,0,2166,2188,2176,0,2165,2189,2192,0,2170,2193,2182,0,2186,2194,2178,0,2190,2161,2180,0,2169,2173,2184,256,2174,2177,2181,0,2202,2242,2153,0,2204,1197,2196,0,2200,2229,2208,0,2206,2216,2212,0,2210,2232,2220,0,2209,2233,2236,0,2214,2237,2226,0,2230,2238,2222,0,2234,2205,2224,0,2213,2217,2228,256,2218,2221,2225,0,2246,2286,2197,0,2248,1201,2240,0,2244,2273,2252,0,2250,2260,2256,0,2254,2276,2264,0,2253,2277,2280,0,2258,2281,2270,0,2274,2282,2266,0,2278,2249,2268,0,2257,2261,2272,256,2262,2265,2269,0,2290,2330,2241,0,2292,1205,2284,0,2288,2317,2296,0,2294,2304,2300,0,2298,2320,2308,0,2297,2321,2324,0,2302,2325,2314,0,2318,2326,2310,0,2322,2293,2312,0,2301,2305,2316,256,2306,2309,2313,0,2334,2374,2285,0,2336,1209,2328,0,2332,2361,2340,0,2338,2348,2344,0,2342,2364,2352,0,2341,2365,2368,0,2346,2369,2358,0,2362,2370,2354,0,2366,2337,2356,0,2345,2349,2360,256,2350,2353,2357,0,2378,2418,2329,0,2380,1213,2372,0,2376,2405,2384,0,2382,2392,2388,0,2386,2408,2396,0,2385,2409,2412,0,2390,2413,2402,0,2406,2414,2398,0,2410,2381,2400,0,2389,2393,2404,256,2394,2397,2401,0,2422,2462,2373,0,2424,1217,2416,0,2420,2449,2428,0,2426,2436,2432,0,2430,2452,2440,0,2429,2453,2456,0,2434,2457,2446,0,2450,2458,2442,0,2454,2425,2444,0,2433,2437,2448,256,2438,2441,2445,0,2466,2506,2417,0,2468,1221,2460,0,2464,2493,2472,0,2470,2480,2476,0,2474,2496,2484,0,2473,2497,2500,0,2478,2501,2490,0,2494,2502,2486,0,2498,2469,2488,0,2477,2481,2492,256,2482,2485,2489,0,2510,2550,2461,0,2512,1225,2504,0,2508,2537,2516,0,2514,2524,2520,0,2518,2540,2528,0,2517,2541,2544,0,2522,2545,2534,0,2538,2546,2530,0,2542,2513,2532,0,2521,2525,2536,256,2526,2529,2533,0,2554,2594,2505,0,2556,1229,2548,0,2552,2581,2560,0,2558,2568,2564,0,2562,2584,2572,0,2561,2585,2588,0,2566,2589,2578,0,2582,2590,2574,0,2586,2557,2576,0,2565,2569,2580,256,2570,2573,2577,0,2598,2638,2549,0,2600,1233,2592,0,2596,2625,2604,0,2602,2612,2608,0,2606,2628,2616,0,2605,2629,2632,0,2610,2633,2622,0,2626,2634,2618,0,2630,2601,2620,0,2609,2613,2624,256,2614,2617,2621,0,2642,2682,2593,0,2644,1237,2636,0,2640,2669,2648,0,2646,2656,2652,0,2650,2672,2660,0,2649,2673,2676,0,2654,2677,2666,0,2670,2678,2662,0,2674,2645,2664,0,2653,2657,2668,256,2658,2661,2665,0,2686,2726,2637,0,2688,1241,2680,0,2684,2713,2692,0,2690,2700,2696,0,2694,2716,2704,0,2693,2717,2720,0,2698,2721,2710,0,2714,2722,2706,0,2718,2689,2708,0,2697,2701,2712,256,2702,2705,2709,0,2730,2770,2681,0,2732,1245,2724,0,2728,2757,2736,0,2734,2744,2740,0,2738,2760,2748,0,2737,2761,2764,0,2742,2765,2754,0,2758,2766,2750,0,2762,2733,2752,0,2741,2745,2756,256,2746,2749,2753,0,2774,2814,2725,0,2776,1249,2768,0,2772,2801,2780,0,2778,2788,2784,0,2782,2804,2792,0,2781,2805,2808,0,2786,2809,2798,0,2802,2810,2794,0,2806,2777,2796,0,2785,2789,2800,256,2790,2793,2797,0,2818,2858,2769,0,2820,1253,2812,0,2816,2845,2824,0,2822,2832,2828,0,2826,2848,2836,0,2825,2849,2852,0,2830,2853,2842,0,2846,2854,2838,0,2850,2821,2840,0,2829,2833,2844,256,2834,2837,2841,0,2862,2902,2813,0,2864,1257,2856,0,2860,2889,2868,0,2866,2876,2872,0,2870,2892,2880,0,2869,2893,2896,0,2874,2897,2886,0,2890,2898,2882,0,2894,2865,2884,0,2873,2877,2888,256,2878,2881,2885,0,2906,2946,2857,0,2908,1261,2900,0,2904,2933,2912,0,2910,2920,2916,0,2914,2936,2924,0,2913,2937,2940,0,2918,2941,2930,0,2934,2942,2926,0,2938,2909,2928,0,2917,2921,2932,256,2922,2925,2929,0,2950,2990,2901,0,2952,1265,2944,0,2948,2977,2956,0,2954,2964,2960,0,2958,2980,2968,0,2957,2981,2984,0,2962,2985,2974,0,2978,2986,2970,0,2982,2953,2972,0,2961,2965,2976,256,2966,2969,2973,0,2994,3034,2945,0,2996,1269,2988,0,2992,3021,3000,0,2998,3008,3004,0,3002,3024,3012,0,3001,3025,3028,0,3006,3029,3018,0,3022,3030,3014,0,3026,2997,3016,0,3005,3009,3020,256,3010,3013,3017,0,3038,3078,2989,0,3040,1273,3032,0,3036,3065,3044,0,3042,3052,3048,0,3046,3068,3056,0,3045,3069,3072,0,3050,3073,3062,0,3066,3074,3058,0,3070,3041,3060,0,3049,3053,3064,256,3054,3057,3061,0,3082,3122,3033,0,3084,1277,3076,0,3080,3109,3088,0,3086,3096,3092,0,3090,3112,3100,0,3089,3113,3116,0,3094,3117,3106,0,3110,3118,3102,0,3114,3085,3104,0,3093,3097,3108,256,3098,3101,3105,0,3126,3166,3077,0,3128,1281,3120,0,3124,3153,3132,0,3130,3140,3136,0,3134,3156,3144,0,3133,3157,3160,0,3138,3161,3150,0,3154,3162,3146,0,3158,3129,3148,0,3137,3141,3152,256,3142,3145,3149,0,3170,3210,3121,0,3172,1285,3164,0,3168,3197,3176,0,3174,3184,3180,0,3178,3200,3188,0,3177,3201,3204,0,3182,3205,3194,0,3198,3206,3190,0,3202,3173,3192,0,3181,3185,3196,256,3186,3189,3193,0,3214,3254,3165,0,3216,1289,3208,0,3212,3241,3220,0,3218,3228,3224,0,3222,3244,3232,0,3221,3245,3248,0,3226,3249,3238,0,3242,3250,3234,0,3246,3217,3236,0,3225,3229,3240,256,3230,3233,3237,0,3258,3298,3209,0,3260,1293,3252,0,3256,3285,3264,0,3262,3272,3268,0,3266,3288,3276,0,3265,3289,3292,0,3270,3293,3282,0,3286,3294,3278,0,3290,3261,3280,0,3269,3273,3284,256,3274,3277,3281,0,3302,3342,3253,0,3304,1297,3296,0,3300,3329,3308,0,3306,3316,3312,0,3310,3332,3320,0,3309,3333,3336,0,3314,3337,3326,0,3330,3338,3322,0,3334,3305,3324,0,3313,3317,3328,256,3318,3321,3325,0,3346,3384,3297,0,3348,1301,3340,0,3344,3373,3352,0,3350,3360,3356,0,3354,3376,3364,0,3353,3377,3380,0,3358,3381,3370,0,3374,3382,3366,0,3378,3349,3368,0,3357,3361,3372,256,3362,3365,3369,0,3341,3385,3388,0,3386,3390,3389,0,3398,3604,801,0,3402,3582,3392,0,3406,3576,3396,0,3408,3436,3400,0,3404,3424,3412,0,3410,3433,3416,0,3414,3425,3420,0,3418,3428,3430,0,3409,3417,3432,0,3421,3434,3422,0,3426,3413,3429,0,3405,3452,3552,0,3468,3449,3446,0,3453,3450,3442,0,3454,3441,3445,0,3437,3444,3448,192,3484,3465,3462,0,3469,3466,3458,0,3470,3457,3461,0,3440,3460,3464,192,3560,3481,3478,0,3485,3482,3474,0,3486,3473,3477,0,3456,3476,3480,192,3516,3497,3494,0,3501,3498,3490,0,3502,3489,3493,0,3561,3492,3496,192,3532,3513,3510,0,3517,3514,3506,0,3518,3505,3509,0,3488,3508,3512,192,3568,3529,3526,0,3533,3530,3522,0,3534,3521,3525,0,3504,3524,3528,192,3572,3545,3542,0,3549,3546,3538,0,3550,3537,3541,0,3569,3540,3544,192,3438,3573,3558,0,3562,3566,3554,0,3472,3500,3556,192,3570,3574,3557,0,3520,3548,3564,192,3536,3553,3565,0,3401,3578,3577,0,3584,0,3397,2,3580,3601,3588,0,3586,3596,3592,0,3590,3600,3598,0,3589,3602,3594,0,3593,3585,3597,0,3393,3606,3605,0,797,3617,3612,0,3610,3616,3618,0,3613,3609,3614,0,793,3908,8226,0,3630,3892,3912,0,3634,3788,3624,0,3638,3776,3628,0,3640,3668,3632,0,3636,3656,3644,0,3642,3665,3648,0,3646,3657,3652,0,3650,3660,3662,0,3641,3649,3664,0,3653,3666,3654,0,3658,3645,3661,0,3637,3684,3752,0,3760,3681,3678,0,3685,3682,3674,0,3686,3673,3677,0,3669,3676,3680,256,3716,3697,3694,0,3701,3698,3690,0,3702,3689,3693,0,3761,3692,3696,256,3732,3713,3710,0,3717,3714,3706,0,3718,3705,3709,0,3688,3708,3712,256,3768,3729,3726,0,3733,3730,3722,0,3734,3721,3725,0,3704,3724,3728,256,3772,3745,3742,0,3749,3746,3738,0,3750,3737,3741,0,3769,3740,3744,256,3670,3773,3758,0,3762,3766,3754,0,3672,3700,3756,256,3770,3774,3757,0,3720,3748,3764,256,3736,3753,3765,0,3633,3784,3780,0,3778,3785,3786,0,3777,3781,3782,0,3629,3804,3792,0,3790,3828,3796,0,3794,3801,3802,0,3806,3797,3798,0,3789,3808,3800,0,3805,3832,3812,0,3810,3849,3816,0,3814,3845,3820,0,3818,3841,3824,0,3822,3837,3830,0,3793,3834,3826,0,3809,3838,3829,0,3842,3825,3833,0,3846,3821,3836,0,3850,3817,3840,0,3852,3813,3844,0,3848,3869,3856,0,3854,3877,3860,0,3858,3885,3864,0,3862,3889,3870,0,3874,3853,3866,16,8,3878,3868,785,3882,3857,3873,16,8,3886,3876,785,3890,3861,3881,16,8,3865,3884,785,3625,3896,3898,0,3893,3900,3894,0,3897,3902,3901,0,4045,3913,3910,0,3621,3914,3906,0,3626,3905,3909,0,3922,7708,8004,0,3926,4072,3916,0,3930,4046,3920,0,3932,3960,3924,0,3928,3948,3936,0,3934,3957,3940,0,3938,3949,3944,0,3942,3952,3954,0,3933,3941,3956,0,3945,3958,3946,0,3950,3937,3953,0,3929,3976,4028,0,3992,3973,3970,0,3977,3974,3966,0,3978,3965,3969,0,3961,3968,3972,256,4008,3989,3986,0,3993,3990,3982,0,3994,3981,3985,0,3964,3984,3988,256,4036,4005,4002,0,4009,4006,3998,0,4010,3997,4001,0,3980,4000,4004,256,4040,4021,4018,0,4025,4022,4014,0,4026,4013,4017,0,4037,4016,4020,256,3962,4041,4034,0,4038,4042,4030,0,3996,4024,4032,256,4012,4029,4033,0,4050,3904,3925,0,4052,0,4044,2,4048,4069,4056,0,4054,4064,4060,0,4058,4068,4066,0,4057,4070,4062,0,4061,4053,4065,0,3921,4080,4076,0,4074,7696,4082,0,4073,4084,4078,0,4081,7704,4088,0,4086,4492,4092,0,4090,4500,4096,0,4094,4644,4100,0,4098,4652,4104,0,4102,4804,4108,0,4106,4812,4112,0,4110,4972,4116,0,4114,4980,4120,0,4118,5140,4124,0,4122,5148,4128,0,4126,4508,4132,0,4130,4520,4136,0,4134,4660,4140,0,4138,4672,4144,0,4142,4820,4148,0,4146,4832,4152,0,4150,4988,4156,0,4154,5000,4160,0,4158,5156,4164,0,4162,5168,4168,0,4166,4532,4172,0,4170,4544,4176,0,4174,4684,4180,0,4178,4696,4184,0,4182,4844,4188,0,4186,4856,4192,0,4190,5012,4196,0,4194,5024,4200,0,4198,5180,4204,0,4202,5192,4208,0,4206,4556,4212,0,4210,4568,4216,0,4214,4708,4220,0,4218,4720,4224,0,4222,4868,4228,0,4226,4880,4232,0,4230,5036,4236,0,4234,5048,4240,0,4238,5204,4244,0,4242,5216,4248,0,4246,4580,4252,0,4250,4592,4256,0,4254,4732,4260,0,4258,4744,4264,0,4262,4892,4268,0,4266,4904,4272,0,4270,5060,4276,0,4274,5072,4280,0,4278,5228,4284,0,4282,5240,7498,0,4581,4294,5132,592,4557,4298,4289,592,4533,4302,4293,592,4509,4493,4297,592,4593,4310,5124,592,4569,4314,4305,592,4545,4318,4309,592,4521,4501,4313,592,4733,4326,4756,592,4709,4330,4321,592,4685,4334,4325,592,4661,4645,4329,592,4745,4342,4776,592,4721,4346,4337,592,4697,4350,4341,592,4673,4653,4345,592,4893,4358,4916,592,4869,4362,4353,592,4845,4366,4357,592,4821,4805,4361,592,4905,4374,4944,592,4881,4378,4369,592,4857,4382,4373,592,4833,4813,4377,592,5061,4390,5084,592,5037,4394,4385,592,5013,4398,4389,592,4989,4973,4393,592,5073,4406,5112,592,5049,4410,4401,592,5025,4414,4405,592,5001,4981,4409,592,5229,4422,4964,592,5205,4426,4417,592,5181,4430,4421,592,5157,5141,4425,592,5241,4438,4956,592,5217,4442,4433,592,5193,4446,4437,592,5169,5149,4441,592,4454,4929,4584,592,4462,4458,4448,528,1,4485,4453,785,31,4477,4452,721,4470,4937,4596,592,4482,4474,4464,528,1,4478,4469,785,4777,4461,4473,320,31,4486,4468,721,4757,4457,4481,320,4513,4494,6792,592,4089,4301,4489,320,4525,4502,6816,592,4093,4317,4497,320,4514,4510,5268,592,4129,4300,4505,320,4537,4488,4504,320,4526,4522,5276,592,4133,4316,4517,320,4549,4496,4516,320,4538,4534,5308,592,4169,4296,4529,320,4561,4512,4528,320,4550,4546,5300,592,4173,4312,4541,320,4573,4524,4540,320,4562,4558,5332,592,4209,4292,4553,320,4585,4536,4552,320,4574,4570,5340,592,4213,4308,4565,320,4597,4548,4564,320,4586,4582,5372,592,4249,4288,4577,320,4450,4560,4576,320,4598,4594,5364,592,4253,4304,4589,320,4466,4572,4588,320,4606,5097,4736,592,4614,4610,4600,528,1,4637,4605,785,31,4629,4604,721,4622,5105,4748,592,4634,4626,4616,528,1,4630,4621,785,4945,4613,4625,320,31,4638,4620,721,4917,4609,4633,320,4665,4646,5404,592,4097,4333,4641,320,4677,4654,5396,592,4101,4349,4649,320,4666,4662,5428,592,4137,4332,4657,320,4689,4640,4656,320,4678,4674,5436,592,4141,4348,4669,320,4701,4648,4668,320,4690,4686,5468,592,4177,4328,4681,320,4713,4664,4680,320,4702,4698,5460,592,4181,4344,4693,320,4725,4676,4692,320,4714,4710,5492,592,4217,4324,4705,320,4737,4688,4704,320,4726,4722,5500,592,4221,4340,4717,320,4749,4700,4716,320,4738,4734,5532,592,4257,4320,4729,320,4602,4712,4728,320,4750,4746,5524,592,4261,4336,4741,320,4618,4724,4740,320,4762,4758,4896,592,4322,4484,4753,320,4770,4766,4752,528,1,4797,4761,785,31,4789,4760,721,4782,4778,4908,592,4338,4476,4773,320,4794,4786,4772,528,1,4790,4781,785,5113,4769,4785,320,31,4798,4780,721,5085,4765,4793,320,4825,4806,5556,592,4105,4365,4801,320,4837,4814,5564,592,4109,4381,4809,320,4826,4822,5596,592,4145,4364,4817,320,4849,4800,4816,320,4838,4834,5588,592,4149,4380,4829,320,4861,4808,4828,320,4850,4846,5620,592,4185,4360,4841,320,4873,4824,4840,320,4862,4858,5628,592,4189,4376,4853,320,4885,4836,4852,320,4874,4870,5660,592,4225,4356,4865,320,4897,4848,4864,320,4886,4882,5652,592,4229,4372,4877,320,4909,4860,4876,320,4898,4894,5684,592,4265,4352,4889,320,4754,4872,4888,320,4910,4906,5692,592,4269,4368,4901,320,4774,4884,4900,320,4922,4918,5064,592,4354,4636,4913,320,4934,4926,4912,528,1,4930,4921,785,4965,4449,4925,320,31,4938,4920,721,4957,4465,4933,320,4950,4946,5076,592,4370,4628,4941,320,4962,4954,4940,528,1,4958,4949,785,4434,4936,4953,320,31,4966,4948,721,4418,4928,4961,320,4993,4974,5724,592,4113,4397,4969,320,5005,4982,5716,592,4117,4413,4977,320,4994,4990,5748,592,4153,4396,4985,320,5017,4968,4984,320,5006,5002,5756,592,4157,4412,4997,320,5029,4976,4996,320,5018,5014,5788,592,4193,4392,5009,320,5041,4992,5008,320,5030,5026,5780,592,4197,4408,5021,320,5053,5004,5020,320,5042,5038,5820,592,4233,4388,5033,320,5065,5016,5032,320,5054,5050,5812,592,4237,4404,5045,320,5077,5028,5044,320,5066,5062,5844,592,4273,4384,5057,320,4914,5040,5056,320,5078,5074,5852,592,4277,4400,5069,320,4942,5052,5068,320,5090,5086,5232,592,4386,4796,5081,320,5102,5094,5080,528,1,5098,5089,785,5133,4601,5093,320,31,5106,5088,721,5125,4617,5101,320,5118,5114,5244,592,4402,4788,5109,320,5130,5122,5108,528,1,5126,5117,785,4306,5104,5121,320,31,5134,5116,721,4290,5096,5129,320,5161,5142,5884,592,4121,4429,5137,320,5173,5150,5876,592,4125,4445,5145,320,5162,5158,5916,592,4161,4428,5153,320,5185,5136,5152,320,5174,5170,5908,592,4165,4444,5165,320,5197,5144,5164,320,5186,5182,5940,592,4201,4424,5177,320,5209,5160,5176,320,5198,5194,5948,592,4205,4440,5189,320,5221,5172,5188,320,5210,5206,5980,592,4241,4420,5201,320,5233,5184,5200,320,5222,5218,5972,592,4245,4436,5213,320,5245,5196,5212,320,5234,5230,6012,592,4281,4416,5225,320,5082,5208,5224,320,5246,5242,6004,592,4285,4432,5237,320,5110,5220,5236,320,5258,5254,6940,528,4,5277,5249,785,28,5269,5248,721,5274,5266,6964,528,4,5270,5261,785,4506,5257,5265,320,28,5278,5260,721,4518,5253,5273,320,5290,5286,6380,528,3,5309,5281,785,29,5301,5280,721,5306,5298,6400,528,3,5302,5293,785,4542,5289,5297,320,29,5310,5292,721,4530,5285,5305,320,5322,5318,6732,528,9,5341,5313,785,23,5333,5312,721,5338,5330,6756,528,9,5334,5325,785,4554,5321,5329,320,23,5342,5324,721,4566,5317,5337,320,5354,5350,6876,528,18,5373,5345,785,14,5365,5344,721,5370,5362,6900,528,18,5366,5357,785,4590,5353,5361,320,14,5374,5356,721,4578,5349,5369,320,5386,5382,6888,528,1,5405,5377,785,31,5397,5376,721,5402,5394,6912,528,1,5398,5389,785,4650,5385,5393,320,31,5406,5388,721,4642,5381,5401,320,5418,5414,6796,528,12,5437,5409,785,20,5429,5408,721,5434,5426,6820,528,12,5430,5421,785,4658,5417,5425,320,20,5438,5420,721,4670,5413,5433,320,5450,5446,6460,528,10,5469,5441,785,22,5461,5440,721,5466,5458,6480,528,10,5462,5453,785,4694,5449,5457,320,22,5470,5452,721,4682,5445,5465,320,5482,5478,6588,528,13,5501,5473,785,19,5493,5472,721,5498,5490,6612,528,13,5494,5485,785,4706,5481,5489,320,19,5502,5484,721,4718,5477,5497,320,5514,5510,6972,528,2,5533,5505,785,30,5525,5504,721,5530,5522,6996,528,2,5526,5517,785,4742,5513,5521,320,30,5534,5516,721,4730,5509,5529,320,5546,5542,6984,528,30,5565,5537,785,2,5557,5536,721,5562,5554,7008,528,30,5558,5549,785,4802,5545,5553,320,2,5566,5548,721,4810,5541,5561,320,5578,5574,6892,528,6,5597,5569,785,26,5589,5568,721,5594,5586,6916,528,6,5590,5581,785,4830,5577,5585,320,26,5598,5580,721,4818,5573,5593,320,5610,5606,6340,528,11,5629,5601,785,21,5621,5600,721,5626,5618,6360,528,11,5622,5613,785,4842,5609,5617,320,21,5630,5612,721,4854,5605,5625,320,5642,5638,6684,528,15,5661,5633,785,17,5653,5632,721,5658,5650,6708,528,15,5654,5645,785,4878,5641,5649,320,17,5662,5644,721,4866,5637,5657,320,5674,5670,6828,528,29,5693,5665,785,3,5685,5664,721,5690,5682,6852,528,29,5686,5677,785,4890,5673,5681,320,3,5694,5676,721,4902,5669,5689,320,5706,5702,6840,528,28,5725,5697,785,4,5717,5696,721,5722,5714,6864,528,28,5718,5709,785,4978,5705,5713,320,4,5726,5708,721,4970,5701,5721,320,5738,5734,6988,528,23,5757,5729,785,9,5749,5728,721,5754,5746,7012,528,23,5750,5741,785,4986,5737,5745,320,9,5758,5740,721,4998,5733,5753,320,5770,5766,6420,528,25,5789,5761,785,7,5781,5760,721,5786,5778,6440,528,25,5782,5773,785,5022,5769,5777,320,7,5790,5772,721,5010,5765,5785,320,5802,5798,6540,528,21,5821,5793,785,11,5813,5792,721,5818,5810,6564,528,21,5814,5805,785,5046,5801,5809,320,11,5822,5804,721,5034,5797,5817,320,5834,5830,6924,528,24,5853,5825,785,8,5845,5824,721,5850,5842,6948,528,24,5846,5837,785,5058,5833,5841,320,8,5854,5836,721,5070,5829,5849,320,5866,5862,6936,528,27,5885,5857,785,5,5877,5856,721,5882,5874,6960,528,27,5878,5869,785,5146,5865,5873,320,5,5886,5868,721,5138,5861,5881,320,5898,5894,6844,528,20,5917,5889,785,12,5909,5888,721,5914,5906,6868,528,20,5910,5901,785,5166,5897,5905,320,12,5918,5900,721,5154,5893,5913,320,5930,5926,6500,528,7,5949,5921,785,25,5941,5920,721,5946,5938,6520,528,7,5942,5933,785,5178,5929,5937,320,25,5950,5932,721,5190,5925,5945,320,5962,5958,6636,528,8,5981,5953,785,24,5973,5952,721,5978,5970,6660,528,8,5974,5965,785,5214,5961,5969,320,24,5982,5964,721,5202,5957,5977,320,5994,5990,6780,528,14,6013,5985,785,18,6005,5984,721,6010,6002,6804,528,14,6006,5997,785,5238,5993,6001,320,18,6014,5996,721,5226,5989,6009,320,6022,6557,7476,592,6153,6026,6016,464,6141,0,6021,658,6034,6581,7484,592,6173,6038,6028,464,6161,0,6033,658,6046,6605,7653,592,6193,6050,6040,464,6181,0,6045,658,6058,6629,7649,592,6213,6062,6052,464,6201,0,6057,658,6070,6653,7613,592,6233,6074,6064,464,6221,0,6069,658,6082,6677,7609,592,6253,6086,6076,464,6241,0,6081,658,6094,6701,7573,592,6273,6098,6088,464,6261,0,6093,658,6106,6725,7569,592,6293,6110,6100,464,6281,0,6105,658,6118,6749,7533,592,6313,6122,6112,464,6301,0,6117,658,6130,6773,7529,592,6333,6134,6124,464,6321,0,6129,658,6146,6142,7685,592,6797,6024,6137,320,6353,6150,6136,464,6154,0,6145,658,6341,6020,6148,320,6166,6162,7681,592,6821,6036,6157,320,6373,6170,6156,464,6174,0,6165,658,6361,6032,6168,320,6186,6182,7645,592,6845,6048,6177,320,6393,6190,6176,464,6194,0,6185,658,6381,6044,6188,320,6206,6202,7641,592,6869,6060,6197,320,6413,6210,6196,464,6214,0,6205,658,6401,6056,6208,320,6226,6222,7605,592,6893,6072,6217,320,6433,6230,6216,464,6234,0,6225,658,6421,6068,6228,320,6246,6242,7601,592,6917,6084,6237,320,6453,6250,6236,464,6254,0,6245,658,6441,6080,6248,320,6266,6262,7565,592,6941,6096,6257,320,6473,6270,6256,464,6274,0,6265,658,6461,6092,6268,320,6286,6282,7561,592,6965,6108,6277,320,6493,6290,6276,464,6294,0,6285,658,6481,6104,6288,320,6306,6302,7525,592,6989,6120,6297,320,6513,6310,6296,464,6314,0,6305,658,6501,6116,6308,320,6326,6322,7521,592,7013,6132,6317,320,6533,6330,6316,464,6334,0,6325,658,6521,6128,6328,320,6346,6342,7677,592,5602,6152,6337,320,6553,6350,6336,464,6354,0,6345,658,6541,6144,6348,320,6366,6362,7673,592,5614,6172,6357,320,6577,6370,6356,464,6374,0,6365,658,6565,6164,6368,320,6386,6382,7637,592,5282,6192,6377,320,6601,6390,6376,464,6394,0,6385,658,6589,6184,6388,320,6406,6402,7633,592,5294,6212,6397,320,6625,6410,6396,464,6414,0,6405,658,6613,6204,6408,320,6426,6422,7597,592,5762,6232,6417,320,6649,6430,6416,464,6434,0,6425,658,6637,6224,6428,320,6446,6442,7593,592,5774,6252,6437,320,6673,6450,6436,464,6454,0,6445,658,6661,6244,6448,320,6466,6462,7557,592,5442,6272,6457,320,6697,6470,6456,464,6474,0,6465,658,6685,6264,6468,320,6486,6482,7553,592,5454,6292,6477,320,6721,6490,6476,464,6494,0,6485,658,6709,6284,6488,320,6506,6502,7517,592,5922,6312,6497,320,6745,6510,6496,464,6514,0,6505,658,6733,6304,6508,320,6526,6522,7513,592,5934,6332,6517,320,6769,6530,6516,464,6534,0,6525,658,6757,6324,6528,320,6546,6542,7669,592,5794,6352,6537,320,6558,6550,6536,464,6554,0,6545,658,6781,6344,6548,320,6793,6017,6544,320,6570,6566,7665,592,5806,6372,6561,320,6582,6574,6560,464,6578,0,6569,658,6805,6364,6572,320,6817,6029,6568,320,6594,6590,7629,592,5474,6392,6585,320,6606,6598,6584,464,6602,0,6593,658,6829,6384,6596,320,6841,6041,6592,320,6618,6614,7625,592,5486,6412,6609,320,6630,6622,6608,464,6626,0,6617,658,6853,6404,6620,320,6865,6053,6616,320,6642,6638,7589,592,5954,6432,6633,320,6654,6646,6632,464,6650,0,6641,658,6877,6424,6644,320,6889,6065,6640,320,6666,6662,7585,592,5966,6452,6657,320,6678,6670,6656,464,6674,0,6665,658,6901,6444,6668,320,6913,6077,6664,320,6690,6686,7549,592,5634,6472,6681,320,6702,6694,6680,464,6698,0,6689,658,6925,6464,6692,320,6937,6089,6688,320,6714,6710,7545,592,5646,6492,6705,320,6726,6718,6704,464,6722,0,6713,658,6949,6484,6716,320,6961,6101,6712,320,6738,6734,7509,592,5314,6512,6729,320,6750,6742,6728,464,6746,0,6737,658,6973,6504,6740,320,6985,6113,6736,320,6762,6758,7505,592,5326,6532,6753,320,6774,6766,6752,464,6770,0,6761,658,6997,6524,6764,320,7009,6125,6760,320,6786,6782,7661,592,5986,6552,6777,320,6798,6790,6776,464,6794,0,6785,658,4490,6556,6788,320,5410,6140,6784,320,6810,6806,7657,592,5998,6576,6801,320,6822,6814,6800,464,6818,0,6809,658,4498,6580,6812,320,5422,6160,6808,320,6834,6830,7621,592,5666,6600,6825,320,6846,6838,6824,464,6842,0,6833,658,5698,6604,6836,320,5890,6180,6832,320,6858,6854,7617,592,5678,6624,6849,320,6870,6862,6848,464,6866,0,6857,658,5710,6628,6860,320,5902,6200,6856,320,6882,6878,7581,592,5346,6648,6873,320,6894,6886,6872,464,6890,0,6881,658,5378,6652,6884,320,5570,6220,6880,320,6906,6902,7577,592,5358,6672,6897,320,6918,6910,6896,464,6914,0,6905,658,5390,6676,6908,320,5582,6240,6904,320,6930,6926,7541,592,5826,6696,6921,320,6942,6934,6920,464,6938,0,6929,658,5858,6700,6932,320,5250,6260,6928,320,6954,6950,7537,592,5838,6720,6945,320,6966,6958,6944,464,6962,0,6953,658,5870,6724,6956,320,5262,6280,6952,320,6978,6974,7501,592,5506,6744,6969,320,6990,6982,6968,464,6986,0,6977,658,5538,6748,6980,320,5730,6300,6976,320,7002,6998,7497,592,5518,6768,6993,320,7014,7006,6992,464,7010,0,7001,658,5550,6772,7004,320,5742,6320,7000,320,7022,7024,7492,4194264,12,7037,7016,913,7017,7030,7254,4194240,7034,7040,7025,4194264,6,7038,7028,913,7053,7021,7033,320,7029,7046,7150,4194240,7050,7056,7041,4194264,3,7054,7044,913,7069,7036,7049,320,7045,7062,7106,4194240,7066,7072,7057,4194264,2,7070,7060,913,7085,7052,7065,320,7061,7078,7100,4194240,7082,7088,7073,4194264,1,7086,7076,913,7113,7068,7081,320,7077,7092,7096,4194240,7089,1,0,4194246,7090,32898,0,4194246,7074,32906,2147483648,4194246,7110,7116,7058,4194264,5,7114,7104,913,7129,7084,7109,320,7105,7122,7144,4194240,7126,7132,7117,4194264,4,7130,7120,913,7157,7112,7125,320,7121,7136,7140,4194240,7133,2147516416,2147483648,4194246,7134,32907,0,4194246,7118,2147483649,0,4194246,7154,7160,7042,4194264,9,7158,7148,913,7173,7128,7153,320,7149,7166,7210,4194240,7170,7176,7161,4194264,8,7174,7164,913,7189,7156,7169,320,7165,7182,7204,4194240,7186,7192,7177,4194264,7,7190,7180,913,7217,7172,7185,320,7181,7196,7200,4194240,7193,2147516545,2147483648,4194246,7194,32777,2147483648,4194246,7178,138,0,4194246,7214,7220,7162,4194264,11,7218,7208,913,7233,7188,7213,320,7209,7226,7248,4194240,7230,7236,7221,4194264,10,7234,7224,913,7261,7216,7229,320,7225,7240,7244,4194240,7237,136,0,4194246,7238,2147516425,0,4194246,7222,2147483658,0,4194246,7258,7264,7026,4194264,18,7262,7252,913,7277,7232,7257,320,7253,7270,7374,4194240,7274,7280,7265,4194264,15,7278,7268,913,7293,7260,7273,320,7269,7286,7330,4194240,7290,7296,7281,4194264,14,7294,7284,913,7309,7276,7289,320,7285,7302,7324,4194240,7306,7312,7297,4194264,13,7310,7300,913,7337,7292,7305,320,7301,7316,7320,4194240,7313,2147516555,0,4194246,7314,139,2147483648,4194246,7298,32905,2147483648,4194246,7334,7340,7282,4194264,17,7338,7328,913,7353,7308,7333,320,7329,7346,7368,4194240,7350,7356,7341,4194264,16,7354,7344,913,7381,7336,7349,320,7345,7360,7364,4194240,7357,32771,2147483648,4194246,7358,32770,2147483648,4194246,7342,128,2147483648,4194246,7378,7384,7266,4194264,21,7382,7372,913,7397,7352,7377,320,7373,7390,7434,4194240,7394,7400,7385,4194264,20,7398,7388,913,7413,7380,7393,320,7389,7406,7428,4194240,7410,7416,7401,4194264,19,7414,7404,913,7441,7396,7409,320,7405,7420,7424,4194240,7417,32778,0,4194246,7418,2147483658,2147483648,4194246,7402,2147516545,2147483648,4194246,7438,7444,7386,4194264,23,7442,7432,913,7457,7412,7437,320,7433,7450,7472,4194240,7454,7460,7445,4194264,22,7458,7448,913,7705,7440,7453,320,7449,7464,7468,4194240,7461,32896,2147483648,4194246,7462,2147483649,0,4194246,7446,2147516424,2147483648,4194246,6018,7481,7693,592,7493,7477,7482,4194240,6030,7490,7689,592,7494,7489,7485,4194240,7018,7480,7488,320,7502,6994,4286,0,7506,6970,7496,0,7510,6754,7500,0,7514,6730,7504,0,7518,6518,7508,0,7522,6498,7512,0,7526,6318,7516,0,7530,6298,7520,0,7534,6126,7524,0,7538,6114,7528,0,7542,6946,7532,0,7546,6922,7536,0,7550,6706,7540,0,7554,6682,7544,0,7558,6478,7548,0,7562,6458,7552,0,7566,6278,7556,0,7570,6258,7560,0,7574,6102,7564,0,7578,6090,7568,0,7582,6898,7572,0,7586,6874,7576,0,7590,6658,7580,0,7594,6634,7584,0,7598,6438,7588,0,7602,6418,7592,0,7606,6238,7596,0,7610,6218,7600,0,7614,6078,7604,0,7618,6066,7608,0,7622,6850,7612,0,7626,6826,7616,0,7630,6610,7620,0,7634,6586,7624,0,7638,6398,7628,0,7642,6378,7632,0,7646,6198,7636,0,7650,6178,7640,0,7654,6054,7644,0,7658,6042,7648,0,7662,6802,7652,0,7666,6778,7656,0,7670,6562,7660,0,7674,6538,7664,0,7678,6358,7668,0,7682,6338,7672,0,7686,6158,7676,0,7690,6138,7680,0,7694,7486,7684,0,7698,7478,7688,0,4077,7702,7692,0,1,7706,7697,17,4085,7456,7701,320,3917,7716,7712,0,7710,7722,7718,0,7709,7720,7714,0,7717,7721,7713,0,7730,7988,8008,0,7734,7888,7724,0,7738,7876,7728,0,7740,7768,7732,0,7736,7756,7744,0,7742,7765,7748,0,7746,7757,7752,0,7750,7760,7762,0,7741,7749,7764,0,7753,7766,7754,0,7758,7745,7761,0,7737,7784,7852,0,7860,7781,7778,0,7785,7782,7774,0,7786,7773,7777,0,7769,7776,7780,256,7816,7797,7794,0,7801,7798,7790,0,7802,7789,7793,0,7861,7792,7796,256,7832,7813,7810,0,7817,7814,7806,0,7818,7805,7809,0,7788,7808,7812,256,7868,7829,7826,0,7833,7830,7822,0,7834,7821,7825,0,7804,7824,7828,256,7872,7845,7842,0,7849,7846,7838,0,7850,7837,7841,0,7869,7840,7844,256,7770,7873,7858,0,7862,7866,7854,0,7772,7800,7856,256,7870,7874,7857,0,7820,7848,7864,256,7836,7853,7865,0,7733,7884,7880,0,7878,7885,7886,0,7877,7881,7882,0,7729,7904,7892,0,7890,7916,7896,0,7894,7901,7902,0,7906,7897,7898,0,7889,7908,7900,0,7905,7920,7912,0,7910,7925,7918,0,7893,7922,7914,0,7909,7926,7917,0,7928,7913,7921,0,7924,7964,7932,0,7930,7956,7946,0,8,7965,7972,721,8,7973,7984,721,7950,7982,7934,0,7954,7978,7944,0,7958,7970,7948,0,7933,7962,7952,0,256,7966,7957,273,7929,7937,7961,4194240,256,7974,7953,273,7938,7941,7969,4194240,256,7985,7949,273,8,7986,7945,721,7942,7977,7981,4194240,7725,7992,7994,0,7989,7996,7990,0,7993,7998,7997,0,8224,8009,8006,0,3918,8010,8002,0,7726,8001,8005,0,8018,8212,8225,0,8022,8176,8012,0,8026,8164,8016,0,8028,8056,8020,0,8024,8044,8032,0,8030,8053,8036,0,8034,8045,8040,0,8038,8048,8050,0,8029,8037,8052,0,8041,8054,8042,0,8046,8033,8049,0,8025,8072,8140,0,8148,8069,8066,0,8073,8070,8062,0,8074,8061,8065,0,8057,8064,8068,256,8104,8085,8082,0,8089,8086,8078,0,8090,8077,8081,0,8149,8080,8084,256,8120,8101,8098,0,8105,8102,8094,0,8106,8093,8097,0,8076,8096,8100,256,8156,8117,8114,0,8121,8118,8110,0,8122,8109,8113,0,8092,8112,8116,256,8160,8133,8130,0,8137,8134,8126,0,8138,8125,8129,0,8157,8128,8132,256,8058,8161,8146,0,8150,8154,8142,0,8060,8088,8144,256,8158,8162,8145,0,8108,8136,8152,256,8124,8141,8153,0,8021,8168,8170,0,8165,8172,8166,0,8169,8174,8173,0,8017,8184,8180,0,8178,8196,8186,0,8177,8188,8182,0,8185,8208,8192,0,8190,8204,8198,0,8181,8200,8194,0,8197,8209,8206,0,8193,8210,8202,0,8189,8201,8205,0,8013,8216,8218,0,8213,8220,8214,0,8217,8222,8221,0,8000,8014,3622,0,8232,165,449,0,8228,8244,8236,0,8234,8432,8456,0,8246,8248,8460,0,8233,8245,8240,4194240,8241,8452,8252,0,8250,8405,8258,0,8262,8302,8254,0,8264,8294,8256,0,8260,8284,8270,0,8274,8276,8266,4194264,0,8285,8268,849,8269,8282,8288,4194240,8329,8286,8277,0,8265,8273,8281,4194240,8278,8290,8289,0,255,8298,8261,465,0,8349,8293,721,8306,8354,8257,0,8308,8342,8300,0,8304,8332,8314,0,8318,8320,8310,4194264,0,8333,8312,849,8313,8326,8336,4194240,8330,8334,8321,0,8381,8280,8324,128,8309,8317,8325,4194240,8322,8338,8337,0,255,8346,8305,465,8,8350,8341,721,8401,8297,8345,4194240,8358,8406,8301,0,8360,8394,8352,0,8356,8384,8366,0,8370,8372,8362,4194264,0,8385,8364,849,8365,8378,8388,4194240,8382,8386,8373,0,8433,8328,8376,128,8361,8369,8377,4194240,8374,8390,8389,0,255,8398,8357,465,16,8402,8393,721,8453,8348,8397,4194240,8410,8253,8353,0,8412,8446,8404,0,8408,8436,8418,0,8422,8424,8414,4194264,0,8437,8416,849,8417,8430,8440,4194240,8434,8438,8425,0,8237,8380,8428,128,8413,8421,8429,4194240,8426,8442,8441,0,255,8450,8409,465,24,8454,8445,721,8249,8400,8449,4194240,8238,8461,8462,0,8242,8457,8458,0,6,8468,1,0,8465,1954047348,8472,4194242,8470,8473,8476,0,8474,8478,8477,0
-};
+// Operation batches
+// =================
+// With `batch_ops`, `reduce` sets aside pairs of an OP1 node and a number
+// instead of rewriting them, keeping both operands, and evaluates them
+// OP_BATCH at a time per kind in loops the compiler vectorizes. Those
+// operands can't change while the pair waits, since both ports hold numbers,
+// but the result port can be rewired, so it is read only when linking. A
+// kind's batch is evaluated when full and every batch at the end of a round.
 
-int main () {
-  Net net;
-  net.nodes = malloc(sizeof(u32) * 200000000);
-  net.redex = malloc(sizeof(u32) * 10000000);
-  net.freed = malloc(sizeof(u32) * 10000000);
+#define OP_BATCH 64
 
-  net.nodes_len = 0;
-  net.redex_len = 0;
-  net.freed_len = 0;
+typedef struct OpBatch {
+  u32 len[16];
+  u32 addr[16][OP_BATCH];
+  u32 fst[16][OP_BATCH];
+  u32 snd[16][OP_BATCH];
+} OpBatch;
+
+void eval_ops(u32 kind, const u32 *restrict fst, const u32 *restrict snd, u32 *restrict res, u32 len) {
+  switch (kind) {
+    case  0: for (u32 i = 0; i < len; ++i) res[i] = fst[i] + snd[i]; break;
+    case  1: for (u32 i = 0; i < len; ++i) res[i] = fst[i] - snd[i]; break;
+    case  2: for (u32 i = 0; i < len; ++i) res[i] = fst[i] * snd[i]; break;
+    case  7: for (u32 i = 0; i < len; ++i) res[i] = fst[i] & snd[i]; break;
+    case  8: for (u32 i = 0; i < len; ++i) res[i] = fst[i] | snd[i]; break;
+    case  9: for (u32 i = 0; i < len; ++i) res[i] = fst[i] ^ snd[i]; break;
+    case 10: for (u32 i = 0; i < len; ++i) res[i] = ~snd[i]; break;
+    case 11: for (u32 i = 0; i < len; ++i) res[i] = fst[i] >> (snd[i] & 31); break;
+    case 12: for (u32 i = 0; i < len; ++i) res[i] = fst[i] << (snd[i] & 31); break;
+    case 13: for (u32 i = 0; i < len; ++i) res[i] = fst[i] > snd[i]; break;
+    case 14: for (u32 i = 0; i < len; ++i) res[i] = fst[i] < snd[i]; break;
+    case 15: for (u32 i = 0; i < len; ++i) res[i] = fst[i] == snd[i]; break;
+    default: for (u32 i = 0; i < len; ++i) res[i] = apply_op(kind, fst[i], snd[i]); break;
+  }
+}
+
+void flush_ops(Net *net, OpBatch *ops, u32 kind) {
+  u32 len = ops->len[kind];
+  u32 res[OP_BATCH];
+  TIME_START();
+  for (u32 i = 0; i < len; ++i) {
+    u64 dst = get_port(net, ops->addr[kind][i], 2);
+    if (type_of(dst) == PTR) prefetch_node(net, addr_of(dst));
+  }
+  eval_ops(kind, ops->fst[kind], ops->snd[kind], res, len);
+  for (u32 i = 0; i < len; ++i) {
+    u32 a_addr = ops->addr[kind][i];
+    COUNT_RULE(net, RULE_UNARY_OPERATION);
+    COUNT_UNARY(net, kind);
+    link_ports(net, get_port(net, a_addr, 2), Numeric(res[i]));
+    free_node(net, a_addr);
+  }
+  TIME_RULE(net);
+  ops->len[kind] = 0;
+}
+
+// Rewrites the pair at `a_addr`, or sets it aside in `ops`, if given. Kinds
+// past the last operation go to `rewrite`, which reports them.
+void step(Net *net, OpBatch *ops, u32 a_addr) {
+  if (ops && get_type(net, a_addr) == OP1) {
+    u64 fst = get_port(net, a_addr, 0);
+    if (type_of(fst) == NUM && get_kind(net, a_addr) < 16) {
+      u32 kind = get_kind(net, a_addr);
+      u32 i = ops->len[kind]++;
+      ops->addr[kind][i] = a_addr;
+      ops->fst[kind][i] = numb_of(fst);
+      ops->snd[kind][i] = numb_of(get_port(net, a_addr, 1));
+      if (i + 1 == OP_BATCH) flush_ops(net, ops, kind);
+      return;
+    }
+  }
+  TIME_START();
+  rewrite(net, a_addr);
+  TIME_RULE(net);
+}
+
+// Whether the next rewrite can take the up to 4 nodes it allocates
+static inline u32 has_room(Net *net) {
+  return net->freed_len >= 4 || (u64)net->nodes_len + 16 <= net->nodes_end || grow_nodes(net, (u64)net->nodes_len + 16);
+}
+
+// Rewrites at most `budget` active pairs, stopping early once the `ticks()`
+// clock passes `deadline` (0 for none). The budget and clock are checked only
+// between rounds, which are kept to DEADLINE_STEPS rewrites when a deadline is
+// set. Pairs left over stay queued, so calling again resumes the reduction.
+// When the node buffer can't grow, it stops before the pair that would need
+// it and sets `exhausted` instead of exiting.
+#define DEADLINE_STEPS 4096
+
+Stats reduce_steps(Net *net, u64 budget, u64 deadline) {
+  Stats stats;
+  stats.rewrites = 0;
+  stats.loops = 0;
+  stats.exhausted = 0;
+  u32 dist = net->prefetch;
+  OpBatch batch;
+  OpBatch *ops = NULL;
+  if (net->batch_ops) {
+    memset(batch.len, 0, sizeof(batch.len));
+    ops = &batch;
+  }
+  while (net->redex_len > 0 && stats.rewrites < budget) {
+    if (deadline && ticks() >= deadline) break;
+    #ifdef FM_STATS
+    u32 depth = net->redex_len;
+    net->tele.depth_log2[32 - __builtin_clz(depth)]++;
+    net->tele.depth_sum += depth;
+    TRACK_PEAK(net, depth_max, depth);
+    #endif
+    u32 l = net->redex_len;
+    if (l > budget - stats.rewrites) l = (u32)(budget - stats.rewrites);
+    if (deadline && l > DEADLINE_STEPS) l = DEADLINE_STEPS;
+    if (net->schedule == SCHEDULE_LIFO) {
+      for (u32 i = 0; i < l; ++i) {
+        if (!has_room(net)) {
+          stats.exhausted = 1;
+          l = i;
+          break;
+        }
+        u32 top = --net->redex_len;
+        if (dist) prefetch_redex(net, net->redex + top, -1, top, dist);
+        step(net, ops, net->redex[top]);
+      }
+    } else {
+      // Pairs left over or created during the round land past `l` and move down
+      if (net->schedule == SCHEDULE_SORTED) sort_redexes(net, l);
+      for (u32 i = 0; i < l; ++i) {
+        if (!has_room(net)) {
+          stats.exhausted = 1;
+          l = i;
+          break;
+        }
+        if (dist) prefetch_redex(net, net->redex + i, 1, l - 1 - i, dist);
+        step(net, ops, net->redex[i]);
+      }
+      net->redex_len -= l;
+      memmove(net->redex, net->redex + l, sizeof(u32) * net->redex_len);
+    }
+    if (ops) {
+      for (u32 kind = 0; kind < 16; ++kind) {
+        if (ops->len[kind]) flush_ops(net, ops, kind);
+      }
+    }
+    stats.rewrites += l;
+    ++stats.loops;
+    if (stats.exhausted) break;
+    if (net->compact_at && net->freed_len > net->compact_at && net->freed_len > net->nodes_len / 8) {
+      compact(net);
+    }
+  }
+  #ifdef FM_STATS
+  stats.tele = net->tele;
+  #endif
+  return stats;
+}
+
+// Rewrites active pairs until none is left, reducing the graph to normal form
+// on one thread; `reduce_parallel` spreads it over several. Unreachable data is
+// freed automatically.
+Stats reduce(Net *net) {
+  return reduce_steps(net, UINT64_MAX, 0);
+}
+
+// Lazy reduction
+// ==============
+// Instead of rewriting every queued pair, `reduce_lazy` walks from the root's
+// port 1 to the pairs the result depends on. A wire entering a principal port
+// from an auxiliary one reaches a head, a node that is part of the result: a
+// weak-head target stops there, a full one goes on into its auxiliary ports.
+// A wire entering an auxiliary port depends on that node's principal port, so
+// the walk steps onto it; if that faces another principal port or a number,
+// the node is rewritten and the walk steps back. A full target also queues
+// the node's other auxiliary port, so every node connected to the result is
+// normalized. The redex queue is ignored
+// and left empty, so pairs nothing depends on are never rewritten. Nodes are
+// marked as the walk passes them, which cuts cycles and shared subterms, but
+// a rewrite may rewire nodes marked earlier in a pass, so passes repeat until
+// one rewrites nothing.
+
+#define TARGET_WHNF 0
+#define TARGET_FULL 1
+
+void push_walk(u64 **stack, u32 *len, u32 *cap, u64 ptrn) {
+  if (*len == *cap) {
+    *cap *= 2;
+    *stack = realloc(*stack, sizeof(u64) * *cap);
+    if (!*stack) out_of_memory("lazy walk");
+  }
+  (*stack)[(*len)++] = ptrn;
+}
+
+Stats reduce_lazy(Net *net, u32 target) {
+  Stats stats;
+  stats.rewrites = 0;
+  stats.loops = 0;
+  stats.exhausted = 0;
+  u64 words = (net->nodes_mem.size / (sizeof(Word) * 4) + 63) / 64;
+  u32 todo_cap = 1024;
+  u32 path_cap = 1024;
+  u64 *todo = malloc(sizeof(u64) * todo_cap);
+  u64 *path = malloc(sizeof(u64) * path_cap);
+  if (!todo || !path) out_of_memory("lazy walk");
+  net->redex_len = 0;
+  u64 before;
+  do {
+    before = stats.rewrites;
+    u64 *seen = calloc(words, sizeof(u64));
+    if (!seen) out_of_memory("lazy walk");
+    seen[0] = 1;
+    u32 todo_len = 0;
+    push_walk(&todo, &todo_len, &todo_cap, Pointer(0, 1));
+    while (todo_len > 0) {
+      u32 path_len = 0;
+      push_walk(&path, &path_len, &path_cap, todo[--todo_len]);
+      while (path_len > 0) {
+        u64 from = path[path_len - 1];
+        u64 ptrn = enter_port(net, from);
+
+        // A port wired to itself was erased; the eager queue never sees it
+        if (ptrn == from) break;
+
+        // Standing on a principal port that faces a number or another one.
+        // Unmarks the pair, whose slots the rewrite may hand to new nodes.
+        if (slot_of(from) == 0 && (type_of(ptrn) == NUM || slot_of(ptrn) == 0)) {
+          seen[addr_of(from) >> 6] &= ~((u64)1 << (addr_of(from) & 63));
+          if (type_of(ptrn) == PTR) seen[addr_of(ptrn) >> 6] &= ~((u64)1 << (addr_of(ptrn) & 63));
+          TIME_START();
+          rewrite(net, addr_of(from));
+          TIME_RULE(net);
+          net->redex_len = 0;
+          ++stats.rewrites;
+          --path_len;
+          continue;
+        }
+        if (type_of(ptrn) == NUM) break;
+        u32 addr = addr_of(ptrn);
+        if ((seen[addr >> 6] >> (addr & 63)) & 1) break;
+        seen[addr >> 6] |= (u64)1 << (addr & 63);
+        if (slot_of(ptrn) != 0) {
+          if (target == TARGET_FULL) push_walk(&todo, &todo_len, &todo_cap, Pointer(addr, 3 - slot_of(ptrn)));
+          push_walk(&path, &path_len, &path_cap, Pointer(addr, 0));
+          continue;
+        }
+        if (target == TARGET_FULL) {
+          push_walk(&todo, &todo_len, &todo_cap, Pointer(addr, 2));
+          push_walk(&todo, &todo_len, &todo_cap, Pointer(addr, 1));
+        }
+        break;
+      }
+    }
+    free(seen);
+    ++stats.loops;
+  } while (stats.rewrites > before);
+  free(todo);
+  free(path);
+  #ifdef FM_STATS
+  stats.tele = net->tele;
+  #endif
+  return stats;
+}
+
+// Parallel reduction
+// ==================
+// Each worker owns a work-stealing deque of redexes and a private view of the
+// net that shares `nodes` but keeps its own `redex` and `freed` stacks. Before
+// rewriting a pair, a worker locks both nodes and every neighbor reachable
+// through their auxiliary ports; those are the only nodes `rewrite` writes
+// to, so each rewrite is atomic and the result matches some serial order.
+// Redexes created by a rewrite are published only after its locks are
+// released, and freshly allocated nodes are unreachable until then.
+
+#define CHUNK_WORDS (1024 * 4)
+#define STEAL_TRIES 8
+
+typedef struct Ring {
+  size_t cap;
+  u32 data[];
+} Ring;
+
+typedef struct Deque {
+  _Atomic(Ring *) ring;
+  atomic_size_t top;
+  atomic_size_t bot;
+  Ring **old;
+  u32 old_len;
+} Deque;
+
+typedef struct Pool Pool;
+
+typedef struct Worker {
+  Net net;
+  Deque deque;
+  Pool *pool;
+  u32 held[6];
+  u32 held_len;
+  u32 seed;
+  u64 rewrites;
+  u64 steals;
+  pthread_t thread;
+} Worker;
+
+struct Pool {
+  _Atomic u8 *locks;
+  atomic_ulong pending;
+  Worker *workers;
+  u32 workers_len;
+};
+
+void refill_chunk(Net *net) {
+  Net *parent = net->parent;
+  if (!parent) {
+    reserve_nodes(net, (u64)net->nodes_end + 4);
+    return;
+  }
+  u64 addr = __atomic_fetch_add(&parent->nodes_len, CHUNK_WORDS, __ATOMIC_RELAXED);
+  if (addr + CHUNK_WORDS > __atomic_load_n(&parent->nodes_end, __ATOMIC_ACQUIRE)) {
+    pthread_mutex_lock(&grow_lock);
+    if (addr + CHUNK_WORDS > 0xFFFFFFFC) out_of_memory("node");
+    reserve_nodes(parent, addr + CHUNK_WORDS);
+    pthread_mutex_unlock(&grow_lock);
+  }
+  net->nodes_len = (u32)addr;
+  net->nodes_end = (u32)addr + CHUNK_WORDS;
+}
+
+Ring *ring_alloc(size_t cap) {
+  Ring *ring = malloc(sizeof(Ring) + sizeof(u32) * cap);
+  ring->cap = cap;
+  return ring;
+}
+
+void deque_init(Deque *dq, size_t cap) {
+  atomic_init(&dq->ring, ring_alloc(cap));
+  atomic_init(&dq->top, 0);
+  atomic_init(&dq->bot, 0);
+  dq->old = malloc(sizeof(Ring*) * 64);
+  dq->old_len = 0;
+}
+
+void deque_free(Deque *dq) {
+  for (u32 i = 0; i < dq->old_len; ++i) {
+    free(dq->old[i]);
+  }
+  free(dq->old);
+  free(atomic_load(&dq->ring));
+}
+
+// Owner only. Doubles the ring when full; stale rings are kept alive until
+// the pool is torn down since thieves may still be reading them.
+void deque_push(Deque *dq, u32 addr) {
+  size_t b = atomic_load_explicit(&dq->bot, memory_order_relaxed);
+  size_t t = atomic_load_explicit(&dq->top, memory_order_acquire);
+  Ring *ring = atomic_load_explicit(&dq->ring, memory_order_relaxed);
+  if (b - t >= ring->cap) {
+    Ring *grown = ring_alloc(ring->cap * 2);
+    for (size_t i = t; i < b; ++i) {
+      grown->data[i & (grown->cap - 1)] = ring->data[i & (ring->cap - 1)];
+    }
+    dq->old[dq->old_len++] = ring;
+    ring = grown;
+    atomic_store_explicit(&dq->ring, ring, memory_order_release);
+  }
+  ring->data[b & (ring->cap - 1)] = addr;
+  atomic_thread_fence(memory_order_release);
+  atomic_store_explicit(&dq->bot, b + 1, memory_order_relaxed);
+}
+
+// Owner only. Takes from the bottom, like the serial LIFO stack.
+u32 deque_pop(Deque *dq, u32 *addr) {
+  size_t b = atomic_load_explicit(&dq->bot, memory_order_relaxed);
+  if (b == 0) return 0;
+  b = b - 1;
+  Ring *ring = atomic_load_explicit(&dq->ring, memory_order_relaxed);
+  atomic_store_explicit(&dq->bot, b, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+  size_t t = atomic_load_explicit(&dq->top, memory_order_relaxed);
+  if (t > b) {
+    atomic_store_explicit(&dq->bot, b + 1, memory_order_relaxed);
+    return 0;
+  }
+  *addr = ring->data[b & (ring->cap - 1)];
+  if (t == b) {
+    u32 won = atomic_compare_exchange_strong_explicit(&dq->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed);
+    atomic_store_explicit(&dq->bot, b + 1, memory_order_relaxed);
+    return won;
+  }
+  return 1;
+}
+
+// Any thread. Takes from the top.
+u32 deque_steal(Deque *dq, u32 *addr) {
+  size_t t = atomic_load_explicit(&dq->top, memory_order_acquire);
+  atomic_thread_fence(memory_order_seq_cst);
+  size_t b = atomic_load_explicit(&dq->bot, memory_order_acquire);
+  if (t >= b) return 0;
+  Ring *ring = atomic_load_explicit(&dq->ring, memory_order_acquire);
+  *addr = ring->data[t & (ring->cap - 1)];
+  return atomic_compare_exchange_strong_explicit(&dq->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed);
+}
+
+void unlock_nodes(Worker *w) {
+  for (u32 i = 0; i < w->held_len; ++i) {
+    atomic_store_explicit(&w->pool->locks[w->held[i]], 0, memory_order_release);
+  }
+  w->held_len = 0;
+}
+
+u32 lock_node(Worker *w, u32 addr) {
+  for (u32 i = 0; i < w->held_len; ++i) {
+    if (w->held[i] == addr) return 1;
+  }
+  if (atomic_exchange_explicit(&w->pool->locks[addr], 1, memory_order_acquire)) {
+    return 0;
+  }
+  w->held[w->held_len++] = addr;
+  return 1;
+}
+
+// Locks the node on the other side of an auxiliary port, if any
+u32 lock_neighbor(Worker *w, u32 addr, u32 slot) {
+  u64 ptrn = get_port(&w->net, addr, slot);
+  return type_of(ptrn) == NUM || lock_node(w, addr_of(ptrn));
+}
+
+// Locks every node `rewrite(net, a_addr)` may write to, or nothing at all
+u32 lock_redex(Worker *w, u32 a_addr) {
+  if (!lock_node(w, a_addr)) goto fail;
+  u64 b_ptrn = get_port(&w->net, a_addr, 0);
+  if (!lock_neighbor(w, a_addr, 1) || !lock_neighbor(w, a_addr, 2)) goto fail;
+  if (type_of(b_ptrn) == PTR) {
+    u32 b_addr = addr_of(b_ptrn);
+    if (!lock_node(w, b_addr)) goto fail;
+    if (!lock_neighbor(w, b_addr, 1) || !lock_neighbor(w, b_addr, 2)) goto fail;
+  }
+  return 1;
+  fail:
+  unlock_nodes(w);
+  return 0;
+}
+
+u32 steal_redex(Worker *w, u32 *addr) {
+  Pool *pool = w->pool;
+  for (u32 i = 0; i < STEAL_TRIES; ++i) {
+    w->seed = w->seed * 1103515245 + 12345;
+    Worker *victim = &pool->workers[(w->seed >> 16) % pool->workers_len];
+    if (victim != w && deque_steal(&victim->deque, addr)) {
+      ++w->steals;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+void *reduce_worker(void *arg) {
+  Worker *w = (Worker*)arg;
+  Pool *pool = w->pool;
+  u32 addr;
+  while (1) {
+    if (!deque_pop(&w->deque, &addr) && !steal_redex(w, &addr)) {
+      if (atomic_load(&pool->pending) == 0) break;
+      sched_yield();
+      continue;
+    }
+    if (!lock_redex(w, addr)) {
+      deque_push(&w->deque, addr);
+      sched_yield();
+      continue;
+    }
+    TIME_START();
+    rewrite(&w->net, addr);
+    TIME_RULE(&w->net);
+    unlock_nodes(w);
+    // Replaces this redex by the ones it created; grows before publishing
+    // and shrinks after, so `pending` never hits zero while work remains
+    u32 len = w->net.redex_len;
+    if (len > 0) atomic_fetch_add(&pool->pending, len - 1);
+    for (u32 i = 0; i < len; ++i) {
+      deque_push(&w->deque, w->net.redex[i]);
+    }
+    if (len == 0) atomic_fetch_sub(&pool->pending, 1);
+    w->net.redex_len = 0;
+    ++w->rewrites;
+  }
+  return NULL;
+}
+
+// Same as `reduce`, but spread over `threads` workers. In this mode `loops`
+// counts successful steals, since there are no global rounds.
+Stats reduce_parallel(Net *net, u32 threads) {
+  Pool pool;
+  // One lock byte per reservable node; untouched pages never become resident
+  u64 locks_size = net->nodes_mem.size / (sizeof(Word) * 4);
+  pool.locks = mmap(NULL, locks_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (pool.locks == MAP_FAILED) out_of_memory("lock");
+  atomic_init(&pool.pending, net->redex_len);
+  pool.workers = malloc(sizeof(Worker) * threads);
+  pool.workers_len = threads;
+
+  for (u32 i = 0; i < threads; ++i) {
+    Worker *w = &pool.workers[i];
+    net_init(&w->net, 0, 0);
+    w->net.nodes = net->nodes;
+    w->net.parent = net;
+    deque_init(&w->deque, 1024);
+    w->pool = &pool;
+    w->held_len = 0;
+    w->seed = i + 1;
+    w->rewrites = 0;
+    w->steals = 0;
+  }
+
+  // Deals the initial redexes round-robin, preserving their LIFO order
+  for (u32 i = 0; i < net->redex_len; ++i) {
+    deque_push(&pool.workers[i % threads].deque, net->redex[i]);
+  }
+  net->redex_len = 0;
+
+  for (u32 i = 0; i < threads; ++i) {
+    pthread_create(&pool.workers[i].thread, NULL, reduce_worker, &pool.workers[i]);
+  }
+
+  Stats stats;
+  stats.rewrites = 0;
+  stats.loops = 0;
+  stats.exhausted = 0;
+  #ifdef FM_STATS
+  stats.tele = net->tele;
+  #endif
+  for (u32 i = 0; i < threads; ++i) {
+    pthread_join(pool.workers[i].thread, NULL);
+  }
+
+  // Returns unused chunk tails and private free lists to the shared net
+  for (u32 i = 0; i < threads; ++i) {
+    Worker *w = &pool.workers[i];
+    for (u32 j = w->net.nodes_len; j < w->net.nodes_end; j += 4) {
+      free_node(net, j / 4);
+    }
+    for (u32 j = 0; j < w->net.freed_len; ++j) {
+      push_freed(net, w->net.freed[j]);
+    }
+    stats.rewrites += w->rewrites;
+    stats.loops += w->steals;
+    #ifdef FM_STATS
+    merge_telemetry(&stats.tele, &w->net.tele);
+    #endif
+    net_free(&w->net);
+    deque_free(&w->deque);
+  }
+  free(pool.workers);
+  munmap((void*)pool.locks, locks_size);
+  return stats;
+}
+
+// Sharded reduction
+// =================
+// `reduce_sharded` runs the parallel reducer's locking protocol across
+// processes instead of threads, so each shard can sit on its own NUMA node
+// and draw on that node's memory bandwidth. The node array, the lock bytes
+// and the shard bookkeeping live in one shared memory object. Nodes are owned
+// by shards a chunk at a time: the loaded net is split into contiguous runs
+// of chunks, and a chunk claimed while reducing belongs to its claimant. Each
+// shard copies its own chunks in after pinning itself to its node's CPUs, so
+// first-touch places their pages locally.
+//
+// A shard rewrites pairs with `rewrite` under the usual locks. The pair's own
+// nodes are rebuilt in place, but port writes to a neighbor owned by another
+// shard are held in an `Outbox` for the length of the rule and then sent to
+// the owner's mailbox, a lock-free bounded MPSC queue. The owner applies them
+// and releases the neighbor's lock, which the sender hands over with its last
+// write. Freed pair nodes go back to their owner the same way, and so does a
+// new pair on another shard's nodes, which is kept local if the mailbox is
+// full. A shard with nothing to do raises its bit in `hungry`; a busy shard
+// that sees it hands over the oldest half of its stack and the ownership of
+// those pairs' chunks, and asks the kernel to move the chunks' pages to the
+// idle shard's node.
+
+#define SHARDS_MAX 64
+#define CHUNK_NODES (CHUNK_WORDS / 4)
+#define MAILBOX_CAP (1 << 16)
+#define MIGRATE_MIN 256
+#define MIGRATE_MAX 1024
+// A rule writes each of the pair's at most four outside ports a few times
+#define OUTBOX_CAP 32
+
+#ifndef MPOL_MF_MOVE
+#define MPOL_MF_MOVE (1 << 1)
+#endif
+#ifndef MPOL_MF_MOVE_ALL
+#define MPOL_MF_MOVE_ALL (1 << 2)
+#endif
+
+// Message tags. A write carries its slot above the kind, and `MSG_UNLOCK`
+// when it is the sender's last write to that node.
+#define MSG_REDEX 0
+#define MSG_WRITE 1
+#define MSG_FREE 2
+#define MSG_UNLOCK 4
+
+typedef struct Cell {
+  atomic_size_t seq;
+  u32 addr;
+  u32 tag;
+  u64 ptrn;
+} Cell;
+
+typedef struct Mailbox {
+  alignas(64) atomic_size_t tail;
+  alignas(64) size_t head;
+  Cell cells[MAILBOX_CAP];
+} Mailbox;
+
+// Writes made by one rule to the locked neighbors in `remote`, in order
+struct Outbox {
+  u32 remote[4];
+  u32 remote_len;
+  u32 addr[OUTBOX_CAP];
+  u32 slot[OUTBOX_CAP];
+  u64 ptrn[OUTBOX_CAP];
+  u32 len;
+};
+
+typedef struct Outbox Outbox;
+
+typedef struct ShardStats {
+  u64 rewrites;
+  u64 sent;
+  u64 writes;
+  u64 migrated;
+  u64 moved;
+  #ifdef FM_STATS
+  Telemetry tele;
+  #endif
+} ShardStats;
+
+// Header of the shared object. `heap` stands in as the parent net from
+// which shards claim chunks; its buffers are never used. `numa` holds the
+// node each shard runs on, or -1 without a topology.
+typedef struct Shared {
+  Net heap;
+  alignas(64) atomic_uint ready;
+  alignas(64) atomic_ulong pending;
+  alignas(64) _Atomic u64 hungry;
+  u32 shards;
+  int numa[SHARDS_MAX];
+  ShardStats stats[SHARDS_MAX];
+} Shared;
+
+typedef struct Shard {
+  Worker worker;
+  Pool pool;
+  Outbox outbox;
+  Shared *shared;
+  Mailbox *mailboxes;
+  u8 *owner;
+  u32 index;
+} Shard;
+
+u32 defer_port(Net *net, u32 addr, u32 slot, u64 ptrn) {
+  Outbox *out = net->outbox;
+  for (u32 i = 0; i < out->remote_len; ++i) {
+    if (out->remote[i] == addr) {
+      out->addr[out->len] = addr;
+      out->slot[out->len] = slot;
+      out->ptrn[out->len] = ptrn;
+      out->len++;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+u32 deferred_port(Net *net, u32 addr, u32 slot, u64 *ptrn) {
+  Outbox *out = net->outbox;
+  for (u32 i = out->len; i-- > 0;) {
+    if (out->addr[i] == addr && out->slot[i] == slot) {
+      *ptrn = out->ptrn[i];
+      return 1;
+    }
+  }
+  return 0;
+}
+
+void mailbox_init(Mailbox *mb) {
+  atomic_init(&mb->tail, 0);
+  mb->head = 0;
+  for (size_t i = 0; i < MAILBOX_CAP; ++i) {
+    atomic_init(&mb->cells[i].seq, i);
+  }
+}
+
+// Any shard. Fails when the mailbox is full.
+u32 mailbox_push(Mailbox *mb, u32 addr, u32 tag, u64 ptrn) {
+  size_t pos = atomic_load_explicit(&mb->tail, memory_order_relaxed);
+  while (1) {
+    Cell *cell = &mb->cells[pos & (MAILBOX_CAP - 1)];
+    size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+    if (seq == pos) {
+      if (atomic_compare_exchange_weak_explicit(&mb->tail, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+        cell->addr = addr;
+        cell->tag = tag;
+        cell->ptrn = ptrn;
+        atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+        return 1;
+      }
+    } else if ((intptr_t)(seq - pos) < 0) {
+      return 0;
+    } else {
+      pos = atomic_load_explicit(&mb->tail, memory_order_relaxed);
+    }
+  }
+}
+
+// Owner only
+u32 mailbox_pop(Mailbox *mb, u32 *addr, u32 *tag, u64 *ptrn) {
+  Cell *cell = &mb->cells[mb->head & (MAILBOX_CAP - 1)];
+  if (atomic_load_explicit(&cell->seq, memory_order_acquire) != mb->head + 1) return 0;
+  *addr = cell->addr;
+  *tag = cell->tag;
+  *ptrn = cell->ptrn;
+  atomic_store_explicit(&cell->seq, mb->head + MAILBOX_CAP, memory_order_release);
+  mb->head++;
+  return 1;
+}
+
+// Pins the calling process to the CPUs of NUMA node `shard` modulo the node
+// count and returns that node, or -1 where sysfs has no node topology
+int place_shard(u32 shard) {
+  char path[64];
+  u32 nodes = 0;
+  while (1) {
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", nodes);
+    if (access(path, R_OK) != 0) break;
+    ++nodes;
+  }
+  if (nodes == 0) return -1;
+  int node = (int)(shard % nodes);
+  snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+  FILE *file = fopen(path, "r");
+  if (!file) return -1;
+  char list[4096];
+  char *s = fgets(list, sizeof(list), file);
+  fclose(file);
+  if (!s) return -1;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  while (*s >= '0' && *s <= '9') {
+    unsigned long lo = strtoul(s, &s, 10);
+    unsigned long hi = *s == '-' ? strtoul(s + 1, &s, 10) : lo;
+    for (unsigned long cpu = lo; cpu <= hi && cpu < CPU_SETSIZE; ++cpu) {
+      CPU_SET(cpu, &set);
+    }
+    if (*s == ',') ++s;
+  }
+  if (CPU_COUNT(&set) > 0) sched_setaffinity(0, sizeof(set), &set);
+  return node;
+}
+
+// Applies a message from another shard to this shard's nodes
+void apply_message(Shard *shard, u32 addr, u32 tag, u64 ptrn) {
+  switch (tag & 3) {
+    case MSG_REDEX:
+      deque_push(&shard->worker.deque, addr);
+      break;
+    case MSG_WRITE:
+      write_port(&shard->worker.net, addr, tag >> 3, ptrn);
+      if (tag & MSG_UNLOCK) atomic_store_explicit(&shard->pool.locks[addr], 0, memory_order_release);
+      break;
+    case MSG_FREE:
+      push_freed(&shard->worker.net, addr);
+      break;
+  }
+}
+
+void drain_inbox(Shard *shard) {
+  Mailbox *inbox = &shard->mailboxes[shard->index];
+  u32 addr, tag;
+  u64 ptrn;
+  while (mailbox_pop(inbox, &addr, &tag, &ptrn)) {
+    apply_message(shard, addr, tag, ptrn);
+  }
+}
+
+// Sends a message that can't be dropped, taking in this shard's own mail
+// while the target's mailbox is full so two shards never wait on each other
+void post_message(Shard *shard, u32 owner, u32 addr, u32 tag, u64 ptrn) {
+  while (!mailbox_push(&shard->mailboxes[owner], addr, tag, ptrn)) {
+    drain_inbox(shard);
+    sched_yield();
+  }
+}
+
+// Queues a new pair with the shard that owns it
+void route_redex(Shard *shard, u32 addr) {
+  u32 owner = shard->owner[addr / CHUNK_NODES];
+  if (owner != shard->index && mailbox_push(&shard->mailboxes[owner], addr, MSG_REDEX, 0)) {
+    shard->shared->stats[shard->index].sent++;
+  } else {
+    deque_push(&shard->worker.deque, addr);
+  }
+}
+
+// Marks the locked neighbors of a pair that other shards own, so the rule's
+// writes to them go to the outbox
+void open_outbox(Shard *shard, u32 a_addr, u32 b_addr) {
+  Worker *w = &shard->worker;
+  Outbox *out = &shard->outbox;
+  out->remote_len = 0;
+  out->len = 0;
+  for (u32 i = 0; i < w->held_len; ++i) {
+    u32 addr = w->held[i];
+    if (addr != a_addr && addr != b_addr && shard->owner[addr / CHUNK_NODES] != shard->index) {
+      out->remote[out->remote_len++] = addr;
+    }
+  }
+  if (out->remote_len > 0) w->net.outbox = out;
+}
+
+// Sends the outbox to the neighbors' owners and hands each written
+// neighbor's lock over with its last write. Freed pair nodes owned by other
+// shards are returned to them too.
+void close_outbox(Shard *shard, u32 a_addr, u32 b_addr) {
+  Worker *w = &shard->worker;
+  Net *net = &w->net;
+  Outbox *out = &shard->outbox;
+  ShardStats *stats = &shard->shared->stats[shard->index];
+  net->outbox = NULL;
+  u32 low = net->freed_len > 2 ? net->freed_len - 2 : 0;
+  for (u32 i = net->freed_len; i-- > low;) {
+    u32 addr = net->freed[i];
+    u32 owner = shard->owner[addr / CHUNK_NODES];
+    if ((addr == a_addr || addr == b_addr) && owner != shard->index) {
+      net->freed[i] = net->freed[--net->freed_len];
+      post_message(shard, owner, addr, MSG_FREE, 0);
+    }
+  }
+  for (u32 i = 0; i < out->len; ++i) {
+    u32 addr = out->addr[i];
+    u32 tag = MSG_WRITE | out->slot[i] << 3;
+    u32 last = 1;
+    for (u32 j = i + 1; j < out->len; ++j) {
+      if (out->addr[j] == addr) last = 0;
+    }
+    if (last) {
+      tag |= MSG_UNLOCK;
+      for (u32 j = 0; j < w->held_len; ++j) {
+        if (w->held[j] == addr) w->held[j] = w->held[--w->held_len];
+      }
+    }
+    post_message(shard, shard->owner[addr / CHUNK_NODES], addr, tag, out->ptrn[i]);
+    stats->writes++;
+  }
+  out->len = 0;
+}
+
+// Moves the resident pages of a chunk to NUMA node `node` and returns how
+// many moved. Pages other shards have touched move only with CAP_SYS_NICE;
+// without it the kernel leaves them where they are.
+u32 move_chunk(Shard *shard, u32 chunk, int node) {
+  u64 page = (u64)sysconf(_SC_PAGESIZE);
+  u64 start = (u64)(uintptr_t)&shard->worker.net.nodes[(u64)chunk * CHUNK_WORDS] & ~(page - 1);
+  u64 end = (u64)(uintptr_t)&shard->worker.net.nodes[((u64)chunk + 1) * CHUNK_WORDS];
+  void *pages[16];
+  int nodes[16];
+  int status[16];
+  unsigned long count = 0;
+  for (u64 at = start; at < end && count < 16; at += page) {
+    pages[count] = (void*)(uintptr_t)at;
+    nodes[count] = node;
+    ++count;
+  }
+  long done = syscall(SYS_move_pages, 0, count, pages, nodes, status, MPOL_MF_MOVE_ALL);
+  if (done < 0 && errno == EPERM) done = syscall(SYS_move_pages, 0, count, pages, nodes, status, MPOL_MF_MOVE);
+  if (done < 0) return 0;
+  u32 moved = 0;
+  for (unsigned long i = 0; i < count; ++i) {
+    moved += status[i] == node;
+  }
+  return moved;
+}
+
+// Hands the oldest half of the stack, and the chunks it points into, to an
+// idle shard, moving the chunks' pages to its node. Short stacks stay put,
+// since moving them costs more than the idle shard would gain.
+void migrate_redexes(Shard *shard, u64 hungry) {
+  Deque *dq = &shard->worker.deque;
+  size_t len = atomic_load_explicit(&dq->bot, memory_order_relaxed) - atomic_load_explicit(&dq->top, memory_order_relaxed);
+  if (len < MIGRATE_MIN) return;
+  u32 target = __builtin_ctzll(hungry);
+  u64 bit = (u64)1 << target;
+  if (!(atomic_fetch_and(&shard->shared->hungry, ~bit) & bit)) return;
+  size_t half = len / 2 < MIGRATE_MAX ? len / 2 : MIGRATE_MAX;
+  int node = shard->shared->numa[target];
+  u32 move = node >= 0 && node != shard->shared->numa[shard->index];
+  u32 addr;
+  for (size_t i = 0; i < half && deque_steal(dq, &addr); ++i) {
+    if (!mailbox_push(&shard->mailboxes[target], addr, MSG_REDEX, 0)) {
+      deque_push(dq, addr);
+      break;
+    }
+    u32 chunk = addr / CHUNK_NODES;
+    shard->shared->stats[shard->index].migrated++;
+    if (shard->owner[chunk] == target) continue;
+    shard->owner[chunk] = (u8)target;
+    if (move) shard->shared->stats[shard->index].moved += move_chunk(shard, chunk, node);
+  }
+}
+
+void run_shard(Shard *shard, Net *net) {
+  Shared *shared = shard->shared;
+  Worker *w = &shard->worker;
+  u32 me = shard->index;
+  u64 my_bit = (u64)1 << me;
+
+  // Copies in the chunks of the loaded net this shard owns, then waits
+  // until every shard has done the same
+  shared->numa[me] = place_shard(me);
+  for (u32 i = 0; i < net->nodes_len; i += CHUNK_WORDS) {
+    if (shard->owner[i / CHUNK_WORDS] == me) {
+      memcpy(&w->net.nodes[i], &net->nodes[i], sizeof(Word) * CHUNK_WORDS);
+    }
+  }
+  for (u32 i = 0; i < net->freed_len; ++i) {
+    if (shard->owner[net->freed[i] / CHUNK_NODES] == me) push_freed(&w->net, net->freed[i]);
+  }
+  for (u32 i = 0; i < net->redex_len; ++i) {
+    if (shard->owner[net->redex[i] / CHUNK_NODES] == me) deque_push(&w->deque, net->redex[i]);
+  }
+  atomic_fetch_add(&shared->ready, 1);
+  while (atomic_load(&shared->ready) < shared->shards) sched_yield();
+
+  u32 addr;
+  while (1) {
+    drain_inbox(shard);
+    if (!deque_pop(&w->deque, &addr)) {
+      if (!(atomic_load_explicit(&shared->hungry, memory_order_relaxed) & my_bit)) {
+        atomic_fetch_or(&shared->hungry, my_bit);
+      }
+      // Every message is posted before the pending count drops, so once it
+      // reaches zero one last drain applies whatever is left
+      if (atomic_load(&shared->pending) == 0) {
+        drain_inbox(shard);
+        break;
+      }
+      sched_yield();
+      continue;
+    }
+    u64 hungry = atomic_load_explicit(&shared->hungry, memory_order_relaxed) & ~my_bit;
+    if (hungry) migrate_redexes(shard, hungry);
+    if (!lock_redex(w, addr)) {
+      deque_push(&w->deque, addr);
+      sched_yield();
+      continue;
+    }
+    u64 b_ptrn = get_port(&w->net, addr, 0);
+    u32 b_addr = type_of(b_ptrn) == PTR ? addr_of(b_ptrn) : addr;
+    open_outbox(shard, addr, b_addr);
+    u32 chunk_end = w->net.nodes_end;
+    TIME_START();
+    rewrite(&w->net, addr);
+    TIME_RULE(&w->net);
+    if (w->net.nodes_end != chunk_end) shard->owner[(w->net.nodes_end - 1) / CHUNK_WORDS] = (u8)me;
+    close_outbox(shard, addr, b_addr);
+    unlock_nodes(w);
+    u32 len = w->net.redex_len;
+    if (len > 0) atomic_fetch_add(&shared->pending, len - 1);
+    for (u32 i = 0; i < len; ++i) {
+      route_redex(shard, w->net.redex[i]);
+    }
+    if (len == 0) atomic_fetch_sub(&shared->pending, 1);
+    w->net.redex_len = 0;
+    shared->stats[me].rewrites++;
+  }
+
+  // Leaves the unused tail of the current chunk free for the parent's scan
+  for (u32 j = w->net.nodes_len; j < w->net.nodes_end; j += 4) {
+    free_node(&w->net, j / 4);
+  }
+  #ifdef FM_STATS
+  shared->stats[me].tele = w->net.tele;
+  #endif
+}
+
+// Same as `reduce`, but spread over `shards` processes. In this mode `loops`
+// counts pairs handed to another shard.
+Stats reduce_sharded(Net *net, u32 shards) {
+  Stats stats;
+  stats.rewrites = 0;
+  stats.loops = 0;
+  stats.exhausted = 0;
+  #ifdef FM_STATS
+  stats.tele = net->tele;
+  #endif
+  if (shards > SHARDS_MAX) shards = SHARDS_MAX;
+
+  // Pads the loaded net to whole chunks, so each chunk has one owner
+  reserve_nodes(net, ((u64)net->nodes_len + CHUNK_WORDS - 1) / CHUNK_WORDS * CHUNK_WORDS);
+  while (net->nodes_len % CHUNK_WORDS) {
+    u32 addr = net->nodes_len / 4;
+    net->nodes_len += 4;
+    free_node(net, addr);
+  }
+
+  // Lays out the header, mailboxes, owner table, lock bytes and nodes in
+  // one sparse object; untouched pages never become resident
+  u64 page = (u64)sysconf(_SC_PAGESIZE);
+  u64 max_nodes = net->nodes_mem.size / (sizeof(Word) * 4);
+  u64 mailboxes_at = (sizeof(Shared) + page - 1) & ~(page - 1);
+  u64 owner_at = mailboxes_at + sizeof(Mailbox) * shards;
+  u64 locks_at = (owner_at + max_nodes / CHUNK_NODES + 1 + page - 1) & ~(page - 1);
+  u64 nodes_at = (locks_at + max_nodes + COMMIT_GRAIN - 1) & ~(COMMIT_GRAIN - 1);
+  u64 size = nodes_at + net->nodes_mem.size;
+  char name[64];
+  snprintf(name, sizeof(name), "/fm-net-%d", (int)getpid());
+  int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) out_of_memory("shared");
+  shm_unlink(name);
+  u8 *base = ftruncate(fd, (off_t)size) == 0 ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, fd, 0) : MAP_FAILED;
+  close(fd);
+  if (base == MAP_FAILED) out_of_memory("shared");
+
+  Shared *shared = (Shared*)base;
+  Mailbox *mailboxes = (Mailbox*)(base + mailboxes_at);
+  u8 *owner = base + owner_at;
+  memset(&shared->heap, 0, sizeof(Net));
+  shared->heap.nodes_len = net->nodes_len;
+  shared->heap.nodes_end = (u32)(max_nodes * 4 < 0xFFFFFFFC ? max_nodes * 4 : 0xFFFFFFFC) / CHUNK_WORDS * CHUNK_WORDS;
+  atomic_init(&shared->ready, 0);
+  atomic_init(&shared->pending, net->redex_len);
+  atomic_init(&shared->hungry, 0);
+  shared->shards = shards;
+  for (u32 i = 0; i < shards; ++i) {
+    shared->numa[i] = -1;
+    mailbox_init(&mailboxes[i]);
+  }
+  u32 chunks = net->nodes_len / CHUNK_WORDS;
+  for (u32 c = 0; c < chunks; ++c) {
+    owner[c] = (u8)((u64)c * shards / chunks);
+  }
+
+  fflush(stdout);
+  pid_t pids[SHARDS_MAX];
+  for (u32 i = 0; i < shards; ++i) {
+    pids[i] = fork();
+    if (pids[i] < 0) out_of_memory("process");
+    if (pids[i] == 0) {
+      Shard shard;
+      shard.shared = shared;
+      shard.mailboxes = mailboxes;
+      shard.owner = owner;
+      shard.index = i;
+      shard.outbox.len = 0;
+      shard.pool.locks = (_Atomic u8*)(base + locks_at);
+      Worker *w = &shard.worker;
+      net_init(&w->net, 0, 0);
+      w->net.nodes = (Word*)(base + nodes_at);
+      w->net.parent = &shared->heap;
+      deque_init(&w->deque, 1024);
+      w->pool = &shard.pool;
+      w->held_len = 0;
+      run_shard(&shard, net);
+      fflush(stdout);
+      _exit(0);
+    }
+  }
+  u32 failed = 0;
+  for (u32 i = 0; i < shards; ++i) {
+    int status;
+    if (waitpid(pids[i], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) failed = 1;
+  }
+  if (failed) {
+    printf("[ERROR]\nA shard exited abnormally.\n");
+    exit(1);
+  }
+
+  // Takes the reduced nodes back and rebuilds the free list from them
+  reserve_nodes(net, shared->heap.nodes_len);
+  memcpy(net->nodes, base + nodes_at, sizeof(Word) * shared->heap.nodes_len);
+  net->nodes_len = shared->heap.nodes_len;
+  net->redex_len = 0;
+  net->freed_len = 0;
+  u32 len = net->nodes_len / 4;
+  u64 *bits = malloc(sizeof(u64) * ((len + 63) / 64));
+  if (!bits) out_of_memory("scan");
+  scan_net(net, bits, NULL);
+  for (u32 addr = 0; addr < len; addr += 64) {
+    for (u64 word = bits[addr >> 6]; word; word &= word - 1) {
+      push_freed(net, addr + __builtin_ctzll(word));
+    }
+  }
+  free(bits);
+
+  for (u32 i = 0; i < shards; ++i) {
+    stats.rewrites += shared->stats[i].rewrites;
+    stats.loops += shared->stats[i].sent + shared->stats[i].migrated;
+    #ifdef FM_STATS
+    merge_telemetry(&stats.tele, &shared->stats[i].tele);
+    #endif
+  }
+  munmap(base, size);
+  return stats;
+}
+
+void print_pointer(u64 ptrn) {
+  if (type_of(ptrn) == NUM) {
+    printf("#%u", numb_of(ptrn));
+  } else {
+    printf("%u", addr_of(ptrn));
+    switch (slot_of(ptrn)) {
+      case 0: printf("a"); break;
+      case 1: printf("b"); break;
+      case 2: printf("c"); break;
+    }
+  }
+}
+
+void print_net(Net* net) {
+  u64 free_bits = 0;
+  for (u32 i = 0; i < net->nodes_len / 4; i++) {
+    if ((i & 63) == 0) {
+      u32 len = net->nodes_len / 4 - i;
+      scan_block(net, i, len < 64 ? len : 64, &free_bits, NULL);
+    }
+    if ((free_bits >> (i & 63)) & 1) {
+      printf("%u: ~\n", i);
+    } else {
+      u32 type = get_type(net, i);
+      u32 kind = get_kind(net, i);
+      printf("%u: ", i);
+      printf("[%u:%u| ", type, kind);
+      print_pointer(get_port(net, i, 0));
+      printf(" ");
+      print_pointer(get_port(net, i, 1));
+      printf(" ");
+      print_pointer(get_port(net, i, 2));
+      printf("]");
+      printf("...");
+      printf("%d ", is_numeric(net, i, 0));
+      printf("%d ", is_numeric(net, i, 1));
+      printf("%d ", is_numeric(net, i, 2));
+      printf("\n");
+    }
+  }
+}
+
+// Hashes the result: every node connected to the root's port 1, with all of
+// its ports. Nodes are numbered in visiting order, so the hash doesn't depend
+// on addresses and equal normal forms hash equally whatever path reduced
+// them. The rest of the root node, and pairs cut off from the result that a
+// lazy reduction left alone, don't count, so lazy full and eager normal forms
+// of the same net hash equally. `seen` must be zeroed and hold a word per
+// node; `todo` holds two ports per node, plus one.
+u64 hash_nodes(Net *net, u32 *seen, u64 *todo) {
+  u32 len = net->nodes_len / 4;
+  if (len == 0) return 0;
+  u32 todo_len = 0;
+  u32 seen_len = 0;
+  u64 hash = 0xCBF29CE484222325;
+  seen[0] = ++seen_len;
+  todo[todo_len++] = Pointer(0, 1);
+  while (todo_len > 0) {
+    u64 ptrn = enter_port(net, todo[--todo_len]);
+    if (type_of(ptrn) == NUM) {
+      hash = (hash ^ ptrn) * 0x100000001B3;
+      continue;
+    }
+    u32 addr = addr_of(ptrn);
+    u32 fresh = !seen[addr];
+    if (fresh) seen[addr] = ++seen_len;
+    hash = (hash ^ (((u64)seen[addr] << 2) | slot_of(ptrn))) * 0x100000001B3;
+    if (!fresh) continue;
+    hash = (hash ^ (get_type(net, addr) | (u64)get_kind(net, addr) << 3)) * 0x100000001B3;
+    for (u32 slot = 3; slot-- > 0;) {
+      if (slot != slot_of(ptrn)) todo[todo_len++] = Pointer(addr, slot);
+    }
+  }
+  return hash;
+}
+
+u64 hash_result(Net *net) {
+  u32 len = net->nodes_len / 4;
+  u32 *seen = calloc(len ? len : 1, sizeof(u32));
+  u64 *todo = malloc(sizeof(u64) * (2 * (u64)len + 1));
+  if (!seen || !todo) out_of_memory("hash");
+  u64 hash = hash_nodes(net, seen, todo);
+  free(seen);
+  free(todo);
+  return hash;
+}
+
+// Net files
+// =========
+// A net file is a NetHeader, the redex list, the free list, zero padding up
+// to `nodes_offset`, then the raw node words. `nodes_offset` is page-aligned
+// so the node words can be mapped copy-on-write straight into the arena.
+// Version 2 added `pre_rewrites`; version 1 headers end before it. Version 3
+// added the size and hash of the file an optimized net was made from, which
+// are 0 for other nets.
+
+#define NET_MAGIC 0x544E4D46 // "FMNT"
+#define NET_VERSION 3
+#define NET_HEADER_V1 32
+#define NET_HEADER_V2 40
+#define NET_ALIGN 4096
+
+typedef struct NetHeader {
+  u32 magic;
+  u32 version;
+  u32 nodes_len;
+  u32 redex_len;
+  u32 freed_len;
+  u32 reserved;
+  u64 nodes_offset;
+  u64 pre_rewrites;
+  u64 source_size;
+  u64 source_hash;
+} NetHeader;
+
+u64 header_bytes(NetHeader *head) {
+  return head->version == 1 ? NET_HEADER_V1 : head->version == 2 ? NET_HEADER_V2 : sizeof(NetHeader);
+}
+
+// Writes the node words in the u32 layout
+u32 save_nodes(Net *net, FILE *file) {
+  #ifdef FM_WIDE_PORTS
+  u32 block[1024];
+  for (u32 i = 0; i < net->nodes_len; i += 1024) {
+    u32 len = net->nodes_len - i < 1024 ? net->nodes_len - i : 1024;
+    get_words(net, i, block, len);
+    if (fwrite(block, sizeof(u32), len, file) != len) return 0;
+  }
+  return 1;
+  #else
+  return fwrite(net->nodes, sizeof(u32), net->nodes_len, file) == net->nodes_len;
+  #endif
+}
+
+u32 save_net(Net *net, const char *path) {
+  FILE *file = fopen(path, "wb");
+  if (!file) {
+    printf("[ERROR]\nCan't write '%s'.\n", path);
+    return 0;
+  }
+  NetHeader head;
+  head.magic = NET_MAGIC;
+  head.version = NET_VERSION;
+  head.nodes_len = net->nodes_len;
+  head.redex_len = net->redex_len;
+  head.freed_len = net->freed_len;
+  head.reserved = 0;
+  head.pre_rewrites = net->pre_rewrites;
+  head.source_size = net->source_size;
+  head.source_hash = net->source_hash;
+  u64 lists = sizeof(head) + ((u64)net->redex_len + net->freed_len) * sizeof(u32);
+  head.nodes_offset = (lists + NET_ALIGN - 1) & ~(u64)(NET_ALIGN - 1);
+  static const u8 zeros[NET_ALIGN] = {0};
+  u32 ok = fwrite(&head, sizeof(head), 1, file) == 1
+    && fwrite(net->redex, sizeof(u32), net->redex_len, file) == net->redex_len
+    && fwrite(net->freed, sizeof(u32), net->freed_len, file) == net->freed_len
+    && fwrite(zeros, 1, head.nodes_offset - lists, file) == head.nodes_offset - lists
+    && save_nodes(net, file);
+  ok = (fclose(file) == 0) && ok;
+  if (!ok) printf("[ERROR]\nCan't write '%s'.\n", path);
+  return ok;
+}
+
+// Checks a header's fields against each other and a file of `size` bytes
+u32 check_header(NetHeader *head, const char *path, u64 size) {
+  if (head->magic != NET_MAGIC || head->version < 1 || head->version > NET_VERSION) {
+    printf("[ERROR]\n'%s' is not a version 1 to %u net file.\n", path, NET_VERSION);
+    return 0;
+  }
+  if (head->version < 2) head->pre_rewrites = 0;
+  if (head->version < 3) {
+    head->source_size = 0;
+    head->source_hash = 0;
+  }
+  u64 lists = header_bytes(head) + ((u64)head->redex_len + head->freed_len) * sizeof(u32);
+  if (head->nodes_len % 4 != 0
+    || head->nodes_offset < lists
+    || head->nodes_offset % NET_ALIGN != 0
+    || head->nodes_offset + (u64)head->nodes_len * sizeof(u32) > size) {
+    printf("[ERROR]\n'%s' is truncated or corrupt.\n", path);
+    return 0;
+  }
+  return 1;
+}
+
+// Whether every address of a redex or free list names a node of the net
+u32 check_list(u32 *list, u32 len, u32 nodes_len) {
+  for (u32 i = 0; i < len; ++i) {
+    if (list[i] >= nodes_len / 4) return 0;
+  }
+  return 1;
+}
+
+// Reads the header of a net file and checks it against the file's size
+u32 read_header(int fd, const char *path, NetHeader *head) {
+  struct stat st;
+  if (fstat(fd, &st) != 0 || pread(fd, head, sizeof(*head), 0) < NET_HEADER_V1) {
+    printf("[ERROR]\nCan't read '%s'.\n", path);
+    return 0;
+  }
+  return check_header(head, path, (u64)st.st_size);
+}
+
+// Loads a net file into a freshly initialized net. The node words are mapped
+// privately over the start of the node arena, so only pages that reduction
+// touches are ever read, and writes never reach the file. The wide layout
+// has to convert them, so it reads the file instead.
+u32 load_net(Net *net, const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    printf("[ERROR]\nCan't open '%s'.\n", path);
+    return 0;
+  }
+  NetHeader head;
+  if (!read_header(fd, path, &head)) {
+    close(fd);
+    return 0;
+  }
+  u64 bytes = (u64)head.nodes_len * sizeof(u32);
+  u64 page = (u64)sysconf(_SC_PAGESIZE);
+  u64 mapped = (bytes + page - 1) & ~(page - 1);
+  if (mapped > net->nodes_mem.size || (u64)head.nodes_len * sizeof(Word) > net->nodes_mem.size) {
+    printf("[ERROR]\n'%s' needs more than the node memory limit.\n", path);
+    close(fd);
+    return 0;
+  }
+  #ifdef FM_WIDE_PORTS
+  u32 can_map = 0;
+  #else
+  u32 can_map = head.nodes_offset % page == 0;
+  #endif
+  if (mapped > 0 && can_map) {
+    void *addr = mmap(net->nodes, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, head.nodes_offset);
+    if (addr == MAP_FAILED) {
+      printf("[ERROR]\nCan't map '%s'.\n", path);
+      close(fd);
+      return 0;
+    }
+    net->nodes_mem.committed = mapped;
+    net->nodes_end = (u32)(mapped / 4);
+  } else {
+    reserve_nodes(net, head.nodes_len);
+    u32 block[1024];
+    for (u32 i = 0; i < head.nodes_len; i += 1024) {
+      u32 len = head.nodes_len - i < 1024 ? head.nodes_len - i : 1024;
+      if (pread(fd, block, sizeof(u32) * len, head.nodes_offset + (u64)i * sizeof(u32)) != (ssize_t)(sizeof(u32) * len)) {
+        printf("[ERROR]\nCan't read '%s'.\n", path);
+        close(fd);
+        return 0;
+      }
+      put_words(net, i, block, len);
+    }
+  }
+  net->nodes_len = head.nodes_len;
+
+  // The redex and free lists are small; they're copied into growable stacks
+  u64 redex_bytes = (u64)head.redex_len * sizeof(u32);
+  u64 freed_bytes = (u64)head.freed_len * sizeof(u32);
+  if (!arena_commit(&net->redex_mem, redex_bytes)) out_of_memory("redex");
+  if (!arena_commit(&net->freed_mem, freed_bytes)) out_of_memory("free list");
+  net->redex_end = (u32)(net->redex_mem.committed / 4);
+  net->freed_end = (u32)(net->freed_mem.committed / 4);
+  u32 ok = pread(fd, net->redex, redex_bytes, header_bytes(&head)) == (ssize_t)redex_bytes
+        && pread(fd, net->freed, freed_bytes, header_bytes(&head) + redex_bytes) == (ssize_t)freed_bytes;
+  close(fd);
+  if (!ok) {
+    printf("[ERROR]\nCan't read '%s'.\n", path);
+    return 0;
+  }
+  if (!check_list(net->redex, head.redex_len, head.nodes_len) || !check_list(net->freed, head.freed_len, head.nodes_len)) {
+    printf("[ERROR]\n'%s' is truncated or corrupt.\n", path);
+    return 0;
+  }
+  net->redex_len = head.redex_len;
+  net->freed_len = head.freed_len;
+  net->pre_rewrites = head.pre_rewrites;
+  net->source_size = head.source_size;
+  net->source_hash = head.source_hash;
+  return 1;
+}
+
+// Reads `len` bytes, however many calls the stream takes; returns bytes read
+u64 read_fully(int fd, void *buf, u64 len) {
+  u64 done = 0;
+  while (done < len) {
+    ssize_t got = read(fd, (u8*)buf + done, len - done);
+    if (got <= 0) break;
+    done += (u64)got;
+  }
+  return done;
+}
+
+// Reads the next net of a stream of net files into an empty net. Returns 1 if
+// one was read, 0 at the end of the stream and -1 if it was cut or corrupt.
+int read_net(Net *net, int fd, const char *name) {
+  // A regular file bounds the net by what is left of it; a pipe can't
+  u64 size = (u64)-1;
+  struct stat st;
+  off_t at = lseek(fd, 0, SEEK_CUR);
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && at >= 0) size = (u64)(st.st_size - at);
+  NetHeader head;
+  u64 got = read_fully(fd, &head, NET_HEADER_V1);
+  if (got == 0) return 0;
+  if (got == NET_HEADER_V1 && head.version > 1) {
+    got += read_fully(fd, (u8*)&head + NET_HEADER_V1, header_bytes(&head) - NET_HEADER_V1);
+  }
+  if (got != header_bytes(&head) || !check_header(&head, name, size)) {
+    if (got != header_bytes(&head)) printf("[ERROR]\n'%s' is truncated or corrupt.\n", name);
+    return -1;
+  }
+  if ((u64)head.nodes_len * sizeof(Word) > net->nodes_mem.size) {
+    printf("[ERROR]\n'%s' needs more than the node memory limit.\n", name);
+    return -1;
+  }
+  u64 redex_bytes = (u64)head.redex_len * sizeof(u32);
+  u64 freed_bytes = (u64)head.freed_len * sizeof(u32);
+  if (!arena_commit(&net->redex_mem, redex_bytes) || !arena_commit(&net->freed_mem, freed_bytes)) {
+    printf("[ERROR]\n'%s' has lists too long to hold.\n", name);
+    return -1;
+  }
+  net->redex_end = (u32)(net->redex_mem.committed / 4);
+  net->freed_end = (u32)(net->freed_mem.committed / 4);
+  u64 pad_bytes = head.nodes_offset - header_bytes(&head) - redex_bytes - freed_bytes;
+  u32 ok = read_fully(fd, net->redex, redex_bytes) == redex_bytes
+        && read_fully(fd, net->freed, freed_bytes) == freed_bytes
+        && check_list(net->redex, head.redex_len, head.nodes_len)
+        && check_list(net->freed, head.freed_len, head.nodes_len);
+
+  // Skips the padding, which a writer may have made longer than a page
+  u8 pad[NET_ALIGN];
+  while (ok && pad_bytes > 0) {
+    u64 len = pad_bytes < NET_ALIGN ? pad_bytes : NET_ALIGN;
+    ok = read_fully(fd, pad, len) == len;
+    pad_bytes -= len;
+  }
+  reserve_nodes(net, head.nodes_len);
+  #ifdef FM_WIDE_PORTS
+  u32 block[1024];
+  for (u32 i = 0; ok && i < head.nodes_len; i += 1024) {
+    u32 len = head.nodes_len - i < 1024 ? head.nodes_len - i : 1024;
+    ok = read_fully(fd, block, sizeof(u32) * len) == sizeof(u32) * len;
+    put_words(net, i, block, len);
+  }
+  #else
+  ok = ok && read_fully(fd, net->nodes, (u64)head.nodes_len * sizeof(u32)) == (u64)head.nodes_len * sizeof(u32);
+  #endif
+  if (!ok) {
+    printf("[ERROR]\n'%s' is truncated or corrupt.\n", name);
+    return -1;
+  }
+  net->nodes_len = head.nodes_len;
+  net->redex_len = head.redex_len;
+  net->freed_len = head.freed_len;
+  net->pre_rewrites = head.pre_rewrites;
+  net->source_size = head.source_size;
+  net->source_hash = head.source_hash;
+  return 1;
+}
+
+// Load-time optimization
+// ======================
+// `optimize` reduces a loaded net as far as it can without making it bigger,
+// so a cached copy starts from a smaller graph. Pairs whose rule allocates
+// nothing (annihilations, erasures, operations, number duplications and
+// branches) are always rewritten, and an OP2 node with numbers on both inputs
+// is folded at once instead of turning into an OP1 first. Other pairs are
+// only rewritten while the live node count stays within what was loaded.
+// Rewrites are added to `pre_rewrites`, two per folded OP2, so that with a
+// later `reduce` they total the same as reducing the original net.
+
+u32 allocates(Net *net, u32 a_addr) {
+  u64 b_ptrn = get_port(net, a_addr, 0);
+  if (type_of(b_ptrn) == NUM) return 0;
+  u32 a_type = get_type(net, a_addr);
+  u32 b_type = get_type(net, addr_of(b_ptrn));
+  return a_type != b_type || (a_type == NOD && get_kind(net, a_addr) != get_kind(net, addr_of(b_ptrn)));
+}
+
+// Rewrites a pair, folding an OP2 with two numbers; returns the rewrites done
+u32 fold(Net *net, u32 a_addr) {
+  u64 fst = get_port(net, a_addr, 0);
+  u64 snd = get_port(net, a_addr, 1);
+  if (type_of(fst) == NUM && type_of(snd) == NUM && get_type(net, a_addr) == OP2) {
+    u32 kind = get_kind(net, a_addr);
+    COUNT_RULE(net, RULE_BINARY_OPERATION);
+    COUNT_RULE(net, RULE_UNARY_OPERATION);
+    COUNT_UNARY(net, kind);
+    link_ports(net, get_port(net, a_addr, 2), Numeric(apply_op(kind, numb_of(snd), numb_of(fst))));
+    free_node(net, a_addr);
+    return 2;
+  }
+  rewrite(net, a_addr);
+  return 1;
+}
+
+void optimize(Net *net) {
+  u32 limit = net->nodes_len / 4 - net->freed_len;
+  u32 held_len = 0;
+  u32 held_cap = 1024;
+  u32 *held = malloc(sizeof(u32) * held_cap);
+  if (!held) out_of_memory("optimizer");
+  while (1) {
+    while (net->redex_len > 0) {
+      u32 a_addr = net->redex[--net->redex_len];
+      if (!allocates(net, a_addr)) {
+        net->pre_rewrites += fold(net, a_addr);
+        continue;
+      }
+      if (held_len == held_cap) {
+        held_cap *= 2;
+        held = realloc(held, sizeof(u32) * held_cap);
+        if (!held) out_of_memory("optimizer");
+      }
+      held[held_len++] = a_addr;
+    }
+
+    // A rule allocates at most 4 nodes and frees the pair
+    if (held_len == 0 || net->nodes_len / 4 - net->freed_len + 2 > limit) break;
+    rewrite(net, held[--held_len]);
+    net->pre_rewrites++;
+  }
+  for (u32 i = 0; i < held_len; ++i) {
+    push_redex(net, held[i]);
+  }
+  free(held);
+  if (net->freed_len > 0) compact(net);
+}
+
+// Hashes every byte of a file, a word at a time; returns 0 if it can't be read
+u32 hash_file(const char *path, u64 *size, u64 *hash) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return 0;
+  u64 block[8192];
+  *size = 0;
+  *hash = 0xCBF29CE484222325;
+  while (1) {
+    u64 got = read_fully(fd, block, sizeof(block));
+    if (got % 8) memset((u8*)block + got, 0, 8 - got % 8);
+    for (u64 i = 0; i < (got + 7) / 8; ++i) {
+      *hash = (*hash ^ block[i]) * 0x100000001B3;
+    }
+    *size += got;
+    if (got < sizeof(block)) break;
+  }
+  close(fd);
+  return 1;
+}
+
+// Loads `path` optimized, from `path`.opt if that was made from a file of the
+// same size and contents, else by optimizing `path` and caching the result
+// there. Timestamps aren't trusted, since copies and checkouts keep or reset
+// them regardless of what changed.
+u32 load_optimized(Net *net, const char *path) {
+  char cache[4096];
+  snprintf(cache, sizeof(cache), "%s.opt", path);
+  u64 size;
+  u64 hash;
+  if (!hash_file(path, &size, &hash)) {
+    printf("[ERROR]\nCan't open '%s'.\n", path);
+    return 0;
+  }
+  int fd = open(cache, O_RDONLY);
+  if (fd >= 0) {
+    NetHeader head;
+    u32 fresh = read_header(fd, cache, &head) && head.source_size == size && head.source_hash == hash;
+    close(fd);
+    if (fresh) return load_net(net, cache);
+  }
+  if (!load_net(net, path)) return 0;
+  optimize(net);
+  net->source_size = size;
+  net->source_hash = hash;
+  save_net(net, cache);
+  return 1;
+}
+
+// def keccak: {s} (bytes_to_hex (Keccak256 (to_chars s)))
+// def main: dup fn = (~512 #keccak) # (fn "")
+// Applies keccak256 1024 times to empty string
+static u32 nodes[] = {
+  2,8466,0,0,8,164,8464,0,4,24,156,0,40,21,18,0,25,22,14,0,26,13,17,0,9,16,20,64,56,37,34,0,41,38,30,0,42,29,33,0,12,32,36,64,72,53,50,0,57,54,46,0,58,45,49,0,28,48,52,64,88,69,66,0,73,70,62,0,74,61,65,0,44,64,68,64,104,85,82,0,89,86,78,0,90,77,81,0,60,80,84,64,120,101,98,0,105,102,94,0,106,93,97,0,76,96,100,64,136,117,114,0,121,118,110,0,122,109,113,0,92,112,116,64,152,133,130,0,137,134,126,0,138,125,129,0,108,128,132,64,160,149,146,0,153,150,142,0,154,141,145,0,124,144,148,64,10,161,162,0,140,157,158,0,5,8229,170,0,172,450,166,0,168,324,178,0,180,320,174,0,176,192,184,0,182,1954047348,188,4194242,186,316,284,0,181,196,296,0,193,221,200,0,198,256,204,0,202,217,208,0,206,280,234,0,222,218,272,528,8,205,213,721,24,197,212,785,3,230,264,977,4,281,225,273,238,254,210,0,265,240,232,4194264,237,246,248,4194240,317,273,241,0,242,250,249,0,258,278,233,0,201,262,252,0,266,268,257,4194264,226,236,260,4194240,261,0,274,4194242,214,245,270,4194240,1,282,253,17,209,229,277,4194240,190,309,290,0,294,0,286,2,298,0,288,2,194,300,292,0,297,313,304,0,302,305,310,0,314,285,306,0,318,301,308,0,189,244,312,128,177,392,440,0,173,328,444,0,325,436,332,0,330,385,338,0,342,386,334,0,393,346,336,0,348,382,341,0,344,376,354,0,358,360,350,4194264,10,369,352,913,353,366,374,4194240,48,370,361,17,377,357,365,4194240,87,378,362,17,349,368,373,4194240,16,437,345,209,390,333,337,0,394,398,384,0,321,340,388,128,400,434,389,0,396,428,406,0,410,412,402,4194264,10,421,404,913,405,418,426,4194240,48,422,413,17,429,409,417,4194240,87,430,414,17,401,420,425,4194240,16,438,397,273,329,381,433,4194240,322,445,446,0,326,441,442,0,452,8230,169,0,448,456,794,0,453,460,808,0,457,505,464,0,462,501,468,0,466,788,472,0,470,493,476,0,474,489,480,0,478,485,486,0,490,481,482,0,494,477,484,0,498,473,488,0,502,790,492,0,506,465,496,0,510,461,500,0,514,520,504,4194264,135,518,508,977,136,789,513,273,509,524,684,4194240,521,665,528,0,526,560,532,0,530,565,536,0,534,573,540,0,538,609,544,0,542,680,550,0,554,682,546,0,558,668,548,0,562,570,552,0,529,566,556,0,1,533,561,17,681,574,557,0,578,537,569,0,580,610,572,0,576,600,584,0,582,592,588,0,586,601,594,0,585,598,590,0,602,604,593,0,581,589,596,0,597,606,605,0,614,541,577,0,616,660,608,0,612,656,620,0,618,636,624,0,622,637,628,0,626,648,634,0,638,640,630,0,621,625,632,0,633,652,644,0,642,657,650,0,629,654,646,0,641,658,649,0,617,645,653,0,613,664,666,0,661,525,662,592,553,677,672,0,670,676,678,0,673,669,674,0,545,568,549,192,522,785,688,0,686,720,692,0,690,725,696,0,694,717,700,0,698,729,704,0,702,709,710,0,714,705,706,0,718,730,708,0,722,697,712,0,689,726,716,0,1,693,721,17,734,701,713,0,736,780,728,0,732,776,740,0,738,756,744,0,742,757,748,0,746,768,754,0,758,760,750,0,741,745,752,0,753,772,764,0,762,777,770,0,749,774,766,0,761,778,769,0,737,765,773,0,733,784,786,0,781,685,782,592,469,517,497,4194240,798,3620,454,0,802,3608,792,0,806,3394,796,0,810,0,800,2,458,812,804,0,809,813,816,0,814,829,820,0,818,865,824,0,822,1168,1174,0,834,817,1160,0,836,866,828,0,832,856,840,0,838,848,844,0,842,857,850,0,841,854,846,0,858,860,849,0,837,845,852,0,853,862,861,0,870,821,833,0,872,916,864,0,868,912,876,0,874,892,880,0,878,893,884,0,882,904,890,0,894,896,886,0,877,881,888,0,889,908,900,0,898,913,906,0,885,910,902,0,897,914,905,0,873,901,909,0,869,921,922,0,1,917,918,593,930,1152,1164,0,934,1132,924,0,938,1116,928,0,940,968,932,0,936,956,944,0,942,965,948,0,946,957,952,0,950,960,962,0,941,949,964,0,953,966,954,0,958,945,961,0,937,1092,1084,0,1100,981,978,0,985,982,974,0,986,973,977,0,1093,976,980,192,1108,997,994,0,1001,998,990,0,1002,989,993,0,1101,992,996,192,1032,1013,1010,0,1017,1014,1006,0,1018,1005,1009,0,1109,1008,1012,192,1048,1029,1026,0,1033,1030,1022,0,1034,1021,1025,0,1004,1024,1028,192,1064,1045,1042,0,1049,1046,1038,0,1050,1037,1041,0,1020,1040,1044,192,1080,1061,1058,0,1065,1062,1054,0,1066,1053,1057,0,1036,1056,1060,192,1112,1077,1074,0,1081,1078,1070,0,1082,1069,1073,0,1052,1072,1076,192,970,1113,1090,0,1094,1098,1086,0,969,984,1088,192,1102,1106,1089,0,972,1000,1096,192,1110,1114,1097,0,988,1016,1104,192,1068,1085,1105,0,933,1124,1120,0,1118,1129,1126,0,1117,1130,1122,0,128,1121,1125,593,929,1144,1136,0,1134,1148,1140,0,1138,1149,1146,0,1133,1150,1142,0,1137,1141,1145,0,925,1154,1153,0,1169,1165,1162,0,830,1166,1158,0,926,1157,1161,0,825,1156,1172,0,1170,1176,826,0,1173,1981,1180,0,1178,2025,1184,0,1182,2069,1188,0,1186,2113,1192,0,1190,2157,1196,0,1194,2201,1200,0,1198,2245,1204,0,1202,2289,1208,0,1206,2333,1212,0,1210,2377,1216,0,1214,2421,1220,0,1218,2465,1224,0,1222,2509,1228,0,1226,2553,1232,0,1230,2597,1236,0,1234,2641,1240,0,1238,2685,1244,0,1242,2729,1248,0,1246,2773,1252,0,1250,2817,1256,0,1254,2861,1260,0,1258,2905,1264,0,1262,2949,1268,0,1266,2993,1272,0,1270,3037,1276,0,1274,3081,1280,0,1278,3125,1284,0,1282,3169,1288,0,1286,3213,1292,0,1290,3257,1296,0,1294,3301,1300,0,1298,3345,1304,0,1302,1305,1308,0,1306,1309,1312,0,1310,1313,1316,0,1314,1317,1320,0,1318,1321,1324,0,1322,1325,1328,0,1326,1329,1332,0,1330,1333,1336,0,1334,1337,1340,0,1338,1341,1344,0,1342,1345,1348,0,1346,1349,1352,0,1350,1353,1356,0,1354,1357,1360,0,1358,1361,1364,0,1362,1365,1368,0,1366,1369,1372,0,1370,1373,1376,0,1374,1377,1380,0,1378,1381,1384,0,1382,1385,1388,0,1386,1389,1392,0,1390,1393,1396,0,1394,1397,1400,0,1398,1401,1404,0,1402,1405,1408,0,1406,1409,1412,0,1410,1413,1416,0,1414,1417,1420,0,1418,1421,1424,0,1422,1425,1428,0,1426,1429,1432,0,1430,1433,1436,0,1434,1437,1440,0,1438,1441,1444,0,1442,1445,1448,0,1446,1449,1452,0,1450,1453,1456,0,1454,1457,1460,0,1458,1461,1464,0,1462,1465,1468,0,1466,1469,1472,0,1470,1473,1476,0,1474,1477,1480,0,1478,1481,1484,0,1482,1485,1488,0,1486,1489,1492,0,1490,1493,1496,0,1494,1497,1500,0,1498,1501,1504,0,1502,1505,1508,0,1506,1509,1512,0,1510,1513,1516,0,1514,1517,1520,0,1518,1521,1524,0,1522,1525,1528,0,1526,1529,1532,0,1530,1533,1536,0,1534,1537,1540,0,1538,1541,1544,0,1542,1545,1548,0,1546,1549,1552,0,1550,1553,1556,0,1554,1557,1560,0,1558,1561,1564,0,1562,1565,1568,0,1566,1569,1572,0,1570,1573,1576,0,1574,1577,1580,0,1578,1581,1584,0,1582,1585,1588,0,1586,1589,1592,0,1590,1593,1596,0,1594,1597,1600,0,1598,1601,1604,0,1602,1605,1608,0,1606,1609,1612,0,1610,1613,1616,0,1614,1617,1620,0,1618,1621,1624,0,1622,1625,1628,0,1626,1629,1632,0,1630,1633,1636,0,1634,1637,1640,0,1638,1641,1644,0,1642,1645,1648,0,1646,1649,1652,0,1650,1653,1656,0,1654,1657,1660,0,1658,1661,1664,0,1662,1665,1668,0,1666,1669,1672,0,1670,1673,1676,0,1674,1677,1680,0,1678,1681,1684,0,1682,1685,1688,0,1686,1689,1692,0,1690,1693,1696,0,1694,1697,1700,0,1698,1701,1704,0,1702,1705,1708,0,1706,1709,1712,0,1710,1713,1716,0,1714,1717,1720,0,1718,1721,1724,0,1722,1725,1728,0,1726,1729,1732,0,1730,1733,1736,0,1734,1737,1740,0,1738,1741,1744,0,1742,1745,1748,0,1746,1749,1752,0,1750,1753,1756,0,1754,1757,1760,0,1758,1761,1764,0,1762,1765,1768,0,1766,1769,1772,0,1770,1773,1776,0,1774,1777,1780,0,1778,1781,1784,0,1782,1785,1788,0,1786,1789,1792,0,1790,1793,1796,0,1794,1797,1800,0,1798,1801,1804,0,1802,1805,1808,0,1806,1809,1812,0,1810,1813,1816,0,1814,1817,1820,0,1818,1821,1824,0,1822,1825,1828,0,1826,1829,1832,0,1830,1833,1836,0,1834,1837,1840,0,1838,1841,1844,0,1842,1845,1848,0,1846,1849,1852,0,1850,1853,1856,0,1854,1857,1860,0,1858,1861,1864,0,1862,1865,1868,0,1866,1869,1872,0,1870,1873,1876,0,1874,1877,1880,0,1878,1881,1884,0,1882,1885,1888,0,1886,1889,1892,0,1890,1893,1896,0,1894,1897,1900,0,1898,1901,1904,0,1902,1905,1908,0,1906,1909,1912,0,1910,1913,1916,0,1914,1917,1920,0,1918,1921,1924,0,1922,1925,1928,0,1926,1929,1932,0,1930,1933,1936,0,1934,1937,1940,0,1938,1941,1944,0,1942,1945,1948,0,1946,1949,1952,0,1950,1953,1956,0,1954,1957,1960,0,1958,1961,1964,0,1962,1965,1968,0,1966,1969,1972,0,1970,1973,1978,0,1982,2022,1974,0,1984,1177,1976,0,1980,2009,1988,0,1986,1996,1992,0,1990,2012,2000,0,1989,2013,2016,0,1994,2017,2006,0,2010,2018,2002,0,2014,1985,2004,0,1993,1997,2008,256,1998,2001,2005,0,2026,2066,1977,0,2028,1181,2020,0,2024,2053,2032,0,2030,2040,2036,0,2034,2056,2044,0,2033,2057,2060,0,2038,2061,2050,0,2054,2062,2046,0,2058,2029,2048,0,2037,2041,2052,256,2042,2045,2049,0,2070,2110,2021,0,2072,1185,2064,0,2068,2097,2076,0,2074,2084,2080,0,2078,2100,2088,0,2077,2101,2104,0,2082,2105,2094,0,2098,2106,2090,0,2102,2073,2092,0,2081,2085,2096,256,2086,2089,2093,0,2114,2154,2065,0,2116,1189,2108,0,2112,2141,2120,0,2118,2128,2124,0,2122,2144,2132,0,2121,2145,2148,0,2126,2149,2138,0,2142,2150,2134,0,2146,2117,2136,0,2125,2129,2140,256,2130,2133,2137,0,2158,2198,2109,0,2160,1193,2152,0,2156,2185,2164,0,2162,2172,2168,0,2166,2188,2176,0,2165,2189,2192,0,2170,2193,2182,0,2186,2194,2178,0,2190,2161,2180,0,2169,2173,2184,256,2174,2177,2181,0,2202,2242,2153,0,2204,1197,2196,0,2200,2229,2208,0,2206,2216,2212,0,2210,2232,2220,0,2209,2233,2236,0,2214,2237,2226,0,2230,2238,2222,0,2234,2205,2224,0,2213,2217,2228,256,2218,2221,2225,0,2246,2286,2197,0,2248,1201,2240,0,2244,2273,2252,0,2250,2260,2256,0,2254,2276,2264,0,2253,2277,2280,0,2258,2281,2270,0,2274,2282,2266,0,2278,2249,2268,0,2257,2261,2272,256,2262,2265,2269,0,2290,2330,2241,0,2292,1205,2284,0,2288,2317,2296,0,2294,2304,2300,0,2298,2320,2308,0,2297,2321,2324,0,2302,2325,2314,0,2318,2326,2310,0,2322,2293,2312,0,2301,2305,2316,256,2306,2309,2313,0,2334,2374,2285,0,2336,1209,2328,0,2332,2361,2340,0,2338,2348,2344,0,2342,2364,2352,0,2341,2365,2368,0,2346,2369,2358,0,2362,2370,2354,0,2366,2337,2356,0,2345,2349,2360,256,2350,2353,2357,0,2378,2418,2329,0,2380,1213,2372,0,2376,2405,2384,0,2382,2392,2388,0,2386,2408,2396,0,2385,2409,2412,0,2390,2413,2402,0,2406,2414,2398,0,2410,2381,2400,0,2389,2393,2404,256,2394,2397,2401,0,2422,2462,2373,0,2424,1217,2416,0,2420,2449,2428,0,2426,2436,2432,0,2430,2452,2440,0,2429,2453,2456,0,2434,2457,2446,0,2450,2458,2442,0,2454,2425,2444,0,2433,2437,2448,256,2438,2441,2445,0,2466,2506,2417,0,2468,1221,2460,0,2464,2493,2472,0,2470,2480,2476,0,2474,2496,2484,0,2473,2497,2500,0,2478,2501,2490,0,2494,2502,2486,0,2498,2469,2488,0,2477,2481,2492,256,2482,2485,2489,0,2510,2550,2461,0,2512,1225,2504,0,2508,2537,2516,0,2514,2524,2520,0,2518,2540,2528,0,2517,2541,2544,0,2522,2545,2534,0,2538,2546,2530,0,2542,2513,2532,0,2521,2525,2536,256,2526,2529,2533,0,2554,2594,2505,0,2556,1229,2548,0,2552,2581,2560,0,2558,2568,2564,0,2562,2584,2572,0,2561,2585,2588,0,2566,2589,2578,0,2582,2590,2574,0,2586,2557,2576,0,2565,2569,2580,256,2570,2573,2577,0,2598,2638,2549,0,2600,1233,2592,0,2596,2625,2604,0,2602,2612,2608,0,2606,2628,2616,0,2605,2629,2632,0,2610,2633,2622,0,2626,2634,2618,0,2630,2601,2620,0,2609,2613,2624,256,2614,2617,2621,0,2642,2682,2593,0,2644,1237,2636,0,2640,2669,2648,0,2646,2656,2652,0,2650,2672,2660,0,2649,2673,2676,0,2654,2677,2666,0,2670,2678,2662,0,2674,2645,2664,0,2653,2657,2668,256,2658,2661,2665,0,2686,2726,2637,0,2688,1241,2680,0,2684,2713,2692,0,2690,2700,2696,0,2694,2716,2704,0,2693,2717,2720,0,2698,2721,2710,0,2714,2722,2706,0,2718,2689,2708,0,2697,2701,2712,256,2702,2705,2709,0,2730,2770,2681,0,2732,1245,2724,0,2728,2757,2736,0,2734,2744,2740,0,2738,2760,2748,0,2737,2761,2764,0,2742,2765,2754,0,2758,2766,2750,0,2762,2733,2752,0,2741,2745,2756,256,2746,2749,2753,0,2774,2814,2725,0,2776,1249,2768,0,2772,2801,2780,0,2778,2788,2784,0,2782,2804,2792,0,2781,2805,2808,0,2786,2809,2798,0,2802,2810,2794,0,2806,2777,2796,0,2785,2789,2800,256,2790,2793,2797,0,2818,2858,2769,0,2820,1253,2812,0,2816,2845,2824,0,2822,2832,2828,0,2826,2848,2836,0,2825,2849,2852,0,2830,2853,2842,0,2846,2854,2838,0,2850,2821,2840,0,2829,2833,2844,256,2834,2837,2841,0,2862,2902,2813,0,2864,1257,2856,0,2860,2889,2868,0,2866,2876,2872,0,2870,2892,2880,0,2869,2893,2896,0,2874,2897,2886,0,2890,2898,2882,0,2894,2865,2884,0,2873,2877,2888,256,2878,2881,2885,0,2906,2946,2857,0,2908,1261,2900,0,2904,2933,2912,0,2910,2920,2916,0,2914,2936,2924,0,2913,2937,2940,0,2918,2941,2930,0,2934,2942,2926,0,2938,2909,2928,0,2917,2921,2932,256,2922,2925,2929,0,2950,2990,2901,0,2952,1265,2944,0,2948,2977,2956,0,2954,2964,2960,0,2958,2980,2968,0,2957,2981,2984,0,2962,2985,2974,0,2978,2986,2970,0,2982,2953,2972,0,2961,2965,2976,256,2966,2969,2973,0,2994,3034,2945,0,2996,1269,2988,0,2992,3021,3000,0,2998,3008,3004,0,3002,3024,3012,0,3001,3025,3028,0,3006,3029,3018,0,3022,3030,3014,0,3026,2997,3016,0,3005,3009,3020,256,3010,3013,3017,0,3038,3078,2989,0,3040,1273,3032,0,3036,3065,3044,0,3042,3052,3048,0,3046,3068,3056,0,3045,3069,3072,0,3050,3073,3062,0,3066,3074,3058,0,3070,3041,3060,0,3049,3053,3064,256,3054,3057,3061,0,3082,3122,3033,0,3084,1277,3076,0,3080,3109,3088,0,3086,3096,3092,0,3090,3112,3100,0,3089,3113,3116,0,3094,3117,3106,0,3110,3118,3102,0,3114,3085,3104,0,3093,3097,3108,256,3098,3101,3105,0,3126,3166,3077,0,3128,1281,3120,0,3124,3153,3132,0,3130,3140,3136,0,3134,3156,3144,0,3133,3157,3160,0,3138,3161,3150,0,3154,3162,3146,0,3158,3129,3148,0,3137,3141,3152,256,3142,3145,3149,0,3170,3210,3121,0,3172,1285,3164,0,3168,3197,3176,0,3174,3184,3180,0,3178,3200,3188,0,3177,3201,3204,0,3182,3205,3194,0,3198,3206,3190,0,3202,3173,3192,0,3181,3185,3196,256,3186,3189,3193,0,3214,3254,3165,0,3216,1289,3208,0,3212,3241,3220,0,3218,3228,3224,0,3222,3244,3232,0,3221,3245,3248,0,3226,3249,3238,0,3242,3250,3234,0,3246,3217,3236,0,3225,3229,3240,256,3230,3233,3237,0,3258,3298,3209,0,3260,1293,3252,0,3256,3285,3264,0,3262,3272,3268,0,3266,3288,3276,0,3265,3289,3292,0,3270,3293,3282,0,3286,3294,3278,0,3290,3261,3280,0,3269,3273,3284,256,3274,3277,3281,0,3302,3342,3253,0,3304,1297,3296,0,3300,3329,3308,0,3306,3316,3312,0,3310,3332,3320,0,3309,3333,3336,0,3314,3337,3326,0,3330,3338,3322,0,3334,3305,3324,0,3313,3317,3328,256,3318,3321,3325,0,3346,3384,3297,0,3348,1301,3340,0,3344,3373,3352,0,3350,3360,3356,0,3354,3376,3364,0,3353,3377,3380,0,3358,3381,3370,0,3374,3382,3366,0,3378,3349,3368,0,3357,3361,3372,256,3362,3365,3369,0,3341,3385,3388,0,3386,3390,3389,0,3398,3604,801,0,3402,3582,3392,0,3406,3576,3396,0,3408,3436,3400,0,3404,3424,3412,0,3410,3433,3416,0,3414,3425,3420,0,3418,3428,3430,0,3409,3417,3432,0,3421,3434,3422,0,3426,3413,3429,0,3405,3452,3552,0,3468,3449,3446,0,3453,3450,3442,0,3454,3441,3445,0,3437,3444,3448,192,3484,3465,3462,0,3469,3466,3458,0,3470,3457,3461,0,3440,3460,3464,192,3560,3481,3478,0,3485,3482,3474,0,3486,3473,3477,0,3456,3476,3480,192,3516,3497,3494,0,3501,3498,3490,0,3502,3489,3493,0,3561,3492,3496,192,3532,3513,3510,0,3517,3514,3506,0,3518,3505,3509,0,3488,3508,3512,192,3568,3529,3526,0,3533,3530,3522,0,3534,3521,3525,0,3504,3524,3528,192,3572,3545,3542,0,3549,3546,3538,0,3550,3537,3541,0,3569,3540,3544,192,3438,3573,3558,0,3562,3566,3554,0,3472,3500,3556,192,3570,3574,3557,0,3520,3548,3564,192,3536,3553,3565,0,3401,3578,3577,0,3584,0,3397,2,3580,3601,3588,0,3586,3596,3592,0,3590,3600,3598,0,3589,3602,3594,0,3593,3585,3597,0,3393,3606,3605,0,797,3617,3612,0,3610,3616,3618,0,3613,3609,3614,0,793,3908,8226,0,3630,3892,3912,0,3634,3788,3624,0,3638,3776,3628,0,3640,3668,3632,0,3636,3656,3644,0,3642,3665,3648,0,3646,3657,3652,0,3650,3660,3662,0,3641,3649,3664,0,3653,3666,3654,0,3658,3645,3661,0,3637,3684,3752,0,3760,3681,3678,0,3685,3682,3674,0,3686,3673,3677,0,3669,3676,3680,256,3716,3697,3694,0,3701,3698,3690,0,3702,3689,3693,0,3761,3692,3696,256,3732,3713,3710,0,3717,3714,3706,0,3718,3705,3709,0,3688,3708,3712,256,3768,3729,3726,0,3733,3730,3722,0,3734,3721,3725,0,3704,3724,3728,256,3772,3745,3742,0,3749,3746,3738,0,3750,3737,3741,0,3769,3740,3744,256,3670,3773,3758,0,3762,3766,3754,0,3672,3700,3756,256,3770,3774,3757,0,3720,3748,3764,256,3736,3753,3765,0,3633,3784,3780,0,3778,3785,3786,0,3777,3781,3782,0,3629,3804,3792,0,3790,3828,3796,0,3794,3801,3802,0,3806,3797,3798,0,3789,3808,3800,0,3805,3832,3812,0,3810,3849,3816,0,3814,3845,3820,0,3818,3841,3824,0,3822,3837,3830,0,3793,3834,3826,0,3809,3838,3829,0,3842,3825,3833,0,3846,3821,3836,0,3850,3817,3840,0,3852,3813,3844,0,3848,3869,3856,0,3854,3877,3860,0,3858,3885,3864,0,3862,3889,3870,0,3874,3853,3866,16,8,3878,3868,785,3882,3857,3873,16,8,3886,3876,785,3890,3861,3881,16,8,3865,3884,785,3625,3896,3898,0,3893,3900,3894,0,3897,3902,3901,0,4045,3913,3910,0,3621,3914,3906,0,3626,3905,3909,0,3922,7708,8004,0,3926,4072,3916,0,3930,4046,3920,0,3932,3960,3924,0,3928,3948,3936,0,3934,3957,3940,0,3938,3949,3944,0,3942,3952,3954,0,3933,3941,3956,0,3945,3958,3946,0,3950,3937,3953,0,3929,3976,4028,0,3992,3973,3970,0,3977,3974,3966,0,3978,3965,3969,0,3961,3968,3972,256,4008,3989,3986,0,3993,3990,3982,0,3994,3981,3985,0,3964,3984,3988,256,4036,4005,4002,0,4009,4006,3998,0,4010,3997,4001,0,3980,4000,4004,256,4040,4021,4018,0,4025,4022,4014,0,4026,4013,4017,0,4037,4016,4020,256,3962,4041,4034,0,4038,4042,4030,0,3996,4024,4032,256,4012,4029,4033,0,4050,3904,3925,0,4052,0,4044,2,4048,4069,4056,0,4054,4064,4060,0,4058,4068,4066,0,4057,4070,4062,0,4061,4053,4065,0,3921,4080,4076,0,4074,7696,4082,0,4073,4084,4078,0,4081,7704,4088,0,4086,4492,4092,0,4090,4500,4096,0,4094,4644,4100,0,4098,4652,4104,0,4102,4804,4108,0,4106,4812,4112,0,4110,4972,4116,0,4114,4980,4120,0,4118,5140,4124,0,4122,5148,4128,0,4126,4508,4132,0,4130,4520,4136,0,4134,4660,4140,0,4138,4672,4144,0,4142,4820,4148,0,4146,4832,4152,0,4150,4988,4156,0,4154,5000,4160,0,4158,5156,4164,0,4162,5168,4168,0,4166,4532,4172,0,4170,4544,4176,0,4174,4684,4180,0,4178,4696,4184,0,4182,4844,4188,0,4186,4856,4192,0,4190,5012,4196,0,4194,5024,4200,0,4198,5180,4204,0,4202,5192,4208,0,4206,4556,4212,0,4210,4568,4216,0,4214,4708,4220,0,4218,4720,4224,0,4222,4868,4228,0,4226,4880,4232,0,4230,5036,4236,0,4234,5048,4240,0,4238,5204,4244,0,4242,5216,4248,0,4246,4580,4252,0,4250,4592,4256,0,4254,4732,4260,0,4258,4744,4264,0,4262,4892,4268,0,4266,4904,4272,0,4270,5060,4276,0,4274,5072,4280,0,4278,5228,4284,0,4282,5240,7498,0,4581,4294,5132,592,4557,4298,4289,592,4533,4302,4293,592,4509,4493,4297,592,4593,4310,5124,592,4569,4314,4305,592,4545,4318,4309,592,4521,4501,4313,592,4733,4326,4756,592,4709,4330,4321,592,4685,4334,4325,592,4661,4645,4329,592,4745,4342,4776,592,4721,4346,4337,592,4697,4350,4341,592,4673,4653,4345,592,4893,4358,4916,592,4869,4362,4353,592,4845,4366,4357,592,4821,4805,4361,592,4905,4374,4944,592,4881,4378,4369,592,4857,4382,4373,592,4833,4813,4377,592,5061,4390,5084,592,5037,4394,4385,592,5013,4398,4389,592,4989,4973,4393,592,5073,4406,5112,592,5049,4410,4401,592,5025,4414,4405,592,5001,4981,4409,592,5229,4422,4964,592,5205,4426,4417,592,5181,4430,4421,592,5157,5141,4425,592,5241,4438,4956,592,5217,4442,4433,592,5193,4446,4437,592,5169,5149,4441,592,4454,4929,4584,592,4462,4458,4448,528,1,4485,4453,785,31,4477,4452,721,4470,4937,4596,592,4482,4474,4464,528,1,4478,4469,785,4777,4461,4473,320,31,4486,4468,721,4757,4457,4481,320,4513,4494,6792,592,4089,4301,4489,320,4525,4502,6816,592,4093,4317,4497,320,4514,4510,5268,592,4129,4300,4505,320,4537,4488,4504,320,4526,4522,5276,592,4133,4316,4517,320,4549,4496,4516,320,4538,4534,5308,592,4169,4296,4529,320,4561,4512,4528,320,4550,4546,5300,592,4173,4312,4541,320,4573,4524,4540,320,4562,4558,5332,592,4209,4292,4553,320,4585,4536,4552,320,4574,4570,5340,592,4213,4308,4565,320,4597,4548,4564,320,4586,4582,5372,592,4249,4288,4577,320,4450,4560,4576,320,4598,4594,5364,592,4253,4304,4589,320,4466,4572,4588,320,4606,5097,4736,592,4614,4610,4600,528,1,4637,4605,785,31,4629,4604,721,4622,5105,4748,592,4634,4626,4616,528,1,4630,4621,785,4945,4613,4625,320,31,4638,4620,721,4917,4609,4633,320,4665,4646,5404,592,4097,4333,4641,320,4677,4654,5396,592,4101,4349,4649,320,4666,4662,5428,592,4137,4332,4657,320,4689,4640,4656,320,4678,4674,5436,592,4141,4348,4669,320,4701,4648,4668,320,4690,4686,5468,592,4177,4328,4681,320,4713,4664,4680,320,4702,4698,5460,592,4181,4344,4693,320,4725,4676,4692,320,4714,4710,5492,592,4217,4324,4705,320,4737,4688,4704,320,4726,4722,5500,592,4221,4340,4717,320,4749,4700,4716,320,4738,4734,5532,592,4257,4320,4729,320,4602,4712,4728,320,4750,4746,5524,592,4261,4336,4741,320,4618,4724,4740,320,4762,4758,4896,592,4322,4484,4753,320,4770,4766,4752,528,1,4797,4761,785,31,4789,4760,721,4782,4778,4908,592,4338,4476,4773,320,4794,4786,4772,528,1,4790,4781,785,5113,4769,4785,320,31,4798,4780,721,5085,4765,4793,320,4825,4806,5556,592,4105,4365,4801,320,4837,4814,5564,592,4109,4381,4809,320,4826,4822,5596,592,4145,4364,4817,320,4849,4800,4816,320,4838,4834,5588,592,4149,4380,4829,320,4861,4808,4828,320,4850,4846,5620,592,4185,4360,4841,320,4873,4824,4840,320,4862,4858,5628,592,4189,4376,4853,320,4885,4836,4852,320,4874,4870,5660,592,4225,4356,4865,320,4897,4848,4864,320,4886,4882,5652,592,4229,4372,4877,320,4909,4860,4876,320,4898,4894,5684,592,4265,4352,4889,320,4754,4872,4888,320,4910,4906,5692,592,4269,4368,4901,320,4774,4884,4900,320,4922,4918,5064,592,4354,4636,4913,320,4934,4926,4912,528,1,4930,4921,785,4965,4449,4925,320,31,4938,4920,721,4957,4465,4933,320,4950,4946,5076,592,4370,4628,4941,320,4962,4954,4940,528,1,4958,4949,785,4434,4936,4953,320,31,4966,4948,721,4418,4928,4961,320,4993,4974,5724,592,4113,4397,4969,320,5005,4982,5716,592,4117,4413,4977,320,4994,4990,5748,592,4153,4396,4985,320,5017,4968,4984,320,5006,5002,5756,592,4157,4412,4997,320,5029,4976,4996,320,5018,5014,5788,592,4193,4392,5009,320,5041,4992,5008,320,5030,5026,5780,592,4197,4408,5021,320,5053,5004,5020,320,5042,5038,5820,592,4233,4388,5033,320,5065,5016,5032,320,5054,5050,5812,592,4237,4404,5045,320,5077,5028,5044,320,5066,5062,5844,592,4273,4384,5057,320,4914,5040,5056,320,5078,5074,5852,592,4277,4400,5069,320,4942,5052,5068,320,5090,5086,5232,592,4386,4796,5081,320,5102,5094,5080,528,1,5098,5089,785,5133,4601,5093,320,31,5106,5088,721,5125,4617,5101,320,5118,5114,5244,592,4402,4788,5109,320,5130,5122,5108,528,1,5126,5117,785,4306,5104,5121,320,31,5134,5116,721,4290,5096,5129,320,5161,5142,5884,592,4121,4429,5137,320,5173,5150,5876,592,4125,4445,5145,320,5162,5158,5916,592,4161,4428,5153,320,5185,5136,5152,320,5174,5170,5908,592,4165,4444,5165,320,5197,5144,5164,320,5186,5182,5940,592,4201,4424,5177,320,5209,5160,5176,320,5198,5194,5948,592,4205,4440,5189,320,5221,5172,5188,320,5210,5206,5980,592,4241,4420,5201,320,5233,5184,5200,320,5222,5218,5972,592,4245,4436,5213,320,5245,5196,5212,320,5234,5230,6012,592,4281,4416,5225,320,5082,5208,5224,320,5246,5242,6004,592,4285,4432,5237,320,5110,5220,5236,320,5258,5254,6940,528,4,5277,5249,785,28,5269,5248,721,5274,5266,6964,528,4,5270,5261,785,4506,5257,5265,320,28,5278,5260,721,4518,5253,5273,320,5290,5286,6380,528,3,5309,5281,785,29,5301,5280,721,5306,5298,6400,528,3,5302,5293,785,4542,5289,5297,320,29,5310,5292,721,4530,5285,5305,320,5322,5318,6732,528,9,5341,5313,785,23,5333,5312,721,5338,5330,6756,528,9,5334,5325,785,4554,5321,5329,320,23,5342,5324,721,4566,5317,5337,320,5354,5350,6876,528,18,5373,5345,785,14,5365,5344,721,5370,5362,6900,528,18,5366,5357,785,4590,5353,5361,320,14,5374,5356,721,4578,5349,5369,320,5386,5382,6888,528,1,5405,5377,785,31,5397,5376,721,5402,5394,6912,528,1,5398,5389,785,4650,5385,5393,320,31,5406,5388,721,4642,5381,5401,320,5418,5414,6796,528,12,5437,5409,785,20,5429,5408,721,5434,5426,6820,528,12,5430,5421,785,4658,5417,5425,320,20,5438,5420,721,4670,5413,5433,320,5450,5446,6460,528,10,5469,5441,785,22,5461,5440,721,5466,5458,6480,528,10,5462,5453,785,4694,5449,5457,320,22,5470,5452,721,4682,5445,5465,320,5482,5478,6588,528,13,5501,5473,785,19,5493,5472,721,5498,5490,6612,528,13,5494,5485,785,4706,5481,5489,320,19,5502,5484,721,4718,5477,5497,320,5514,5510,6972,528,2,5533,5505,785,30,5525,5504,721,5530,5522,6996,528,2,5526,5517,785,4742,5513,5521,320,30,5534,5516,721,4730,5509,5529,320,5546,5542,6984,528,30,5565,5537,785,2,5557,5536,721,5562,5554,7008,528,30,5558,5549,785,4802,5545,5553,320,2,5566,5548,721,4810,5541,5561,320,5578,5574,6892,528,6,5597,5569,785,26,5589,5568,721,5594,5586,6916,528,6,5590,5581,785,4830,5577,5585,320,26,5598,5580,721,4818,5573,5593,320,5610,5606,6340,528,11,5629,5601,785,21,5621,5600,721,5626,5618,6360,528,11,5622,5613,785,4842,5609,5617,320,21,5630,5612,721,4854,5605,5625,320,5642,5638,6684,528,15,5661,5633,785,17,5653,5632,721,5658,5650,6708,528,15,5654,5645,785,4878,5641,5649,320,17,5662,5644,721,4866,5637,5657,320,5674,5670,6828,528,29,5693,5665,785,3,5685,5664,721,5690,5682,6852,528,29,5686,5677,785,4890,5673,5681,320,3,5694,5676,721,4902,5669,5689,320,5706,5702,6840,528,28,5725,5697,785,4,5717,5696,721,5722,5714,6864,528,28,5718,5709,785,4978,5705,5713,320,4,5726,5708,721,4970,5701,5721,320,5738,5734,6988,528,23,5757,5729,785,9,5749,5728,721,5754,5746,7012,528,23,5750,5741,785,4986,5737,5745,320,9,5758,5740,721,4998,5733,5753,320,5770,5766,6420,528,25,5789,5761,785,7,5781,5760,721,5786,5778,6440,528,25,5782,5773,785,5022,5769,5777,320,7,5790,5772,721,5010,5765,5785,320,5802,5798,6540,528,21,5821,5793,785,11,5813,5792,721,5818,5810,6564,528,21,5814,5805,785,5046,5801,5809,320,11,5822,5804,721,5034,5797,5817,320,5834,5830,6924,528,24,5853,5825,785,8,5845,5824,721,5850,5842,6948,528,24,5846,5837,785,5058,5833,5841,320,8,5854,5836,721,5070,5829,5849,320,5866,5862,6936,528,27,5885,5857,785,5,5877,5856,721,5882,5874,6960,528,27,5878,5869,785,5146,5865,5873,320,5,5886,5868,721,5138,5861,5881,320,5898,5894,6844,528,20,5917,5889,785,12,5909,5888,721,5914,5906,6868,528,20,5910,5901,785,5166,5897,5905,320,12,5918,5900,721,5154,5893,5913,320,5930,5926,6500,528,7,5949,5921,785,25,5941,5920,721,5946,5938,6520,528,7,5942,5933,785,5178,5929,5937,320,25,5950,5932,721,5190,5925,5945,320,5962,5958,6636,528,8,5981,5953,785,24,5973,5952,721,5978,5970,6660,528,8,5974,5965,785,5214,5961,5969,320,24,5982,5964,721,5202,5957,5977,320,5994,5990,6780,528,14,6013,5985,785,18,6005,5984,721,6010,6002,6804,528,14,6006,5997,785,5238,5993,6001,320,18,6014,5996,721,5226,5989,6009,320,6022,6557,7476,592,6153,6026,6016,464,6141,0,6021,658,6034,6581,7484,592,6173,6038,6028,464,6161,0,6033,658,6046,6605,7653,592,6193,6050,6040,464,6181,0,6045,658,6058,6629,7649,592,6213,6062,6052,464,6201,0,6057,658,6070,6653,7613,592,6233,6074,6064,464,6221,0,6069,658,6082,6677,7609,592,6253,6086,6076,464,6241,0,6081,658,6094,6701,7573,592,6273,6098,6088,464,6261,0,6093,658,6106,6725,7569,592,6293,6110,6100,464,6281,0,6105,658,6118,6749,7533,592,6313,6122,6112,464,6301,0,6117,658,6130,6773,7529,592,6333,6134,6124,464,6321,0,6129,658,6146,6142,7685,592,6797,6024,6137,320,6353,6150,6136,464,6154,0,6145,658,6341,6020,6148,320,6166,6162,7681,592,6821,6036,6157,320,6373,6170,6156,464,6174,0,6165,658,6361,6032,6168,320,6186,6182,7645,592,6845,6048,6177,320,6393,6190,6176,464,6194,0,6185,658,6381,6044,6188,320,6206,6202,7641,592,6869,6060,6197,320,6413,6210,6196,464,6214,0,6205,658,6401,6056,6208,320,6226,6222,7605,592,6893,6072,6217,320,6433,6230,6216,464,6234,0,6225,658,6421,6068,6228,320,6246,6242,7601,592,6917,6084,6237,320,6453,6250,6236,464,6254,0,6245,658,6441,6080,6248,320,6266,6262,7565,592,6941,6096,6257,320,6473,6270,6256,464,6274,0,6265,658,6461,6092,6268,320,6286,6282,7561,592,6965,6108,6277,320,6493,6290,6276,464,6294,0,6285,658,6481,6104,6288,320,6306,6302,7525,592,6989,6120,6297,320,6513,6310,6296,464,6314,0,6305,658,6501,6116,6308,320,6326,6322,7521,592,7013,6132,6317,320,6533,6330,6316,464,6334,0,6325,658,6521,6128,6328,320,6346,6342,7677,592,5602,6152,6337,320,6553,6350,6336,464,6354,0,6345,658,6541,6144,6348,320,6366,6362,7673,592,5614,6172,6357,320,6577,6370,6356,464,6374,0,6365,658,6565,6164,6368,320,6386,6382,7637,592,5282,6192,6377,320,6601,6390,6376,464,6394,0,6385,658,6589,6184,6388,320,6406,6402,7633,592,5294,6212,6397,320,6625,6410,6396,464,6414,0,6405,658,6613,6204,6408,320,6426,6422,7597,592,5762,6232,6417,320,6649,6430,6416,464,6434,0,6425,658,6637,6224,6428,320,6446,6442,7593,592,5774,6252,6437,320,6673,6450,6436,464,6454,0,6445,658,6661,6244,6448,320,6466,6462,7557,592,5442,6272,6457,320,6697,6470,6456,464,6474,0,6465,658,6685,6264,6468,320,6486,6482,7553,592,5454,6292,6477,320,6721,6490,6476,464,6494,0,6485,658,6709,6284,6488,320,6506,6502,7517,592,5922,6312,6497,320,6745,6510,6496,464,6514,0,6505,658,6733,6304,6508,320,6526,6522,7513,592,5934,6332,6517,320,6769,6530,6516,464,6534,0,6525,658,6757,6324,6528,320,6546,6542,7669,592,5794,6352,6537,320,6558,6550,6536,464,6554,0,6545,658,6781,6344,6548,320,6793,6017,6544,320,6570,6566,7665,592,5806,6372,6561,320,6582,6574,6560,464,6578,0,6569,658,6805,6364,6572,320,6817,6029,6568,320,6594,6590,7629,592,5474,6392,6585,320,6606,6598,6584,464,6602,0,6593,658,6829,6384,6596,320,6841,6041,6592,320,6618,6614,7625,592,5486,6412,6609,320,6630,6622,6608,464,6626,0,6617,658,6853,6404,6620,320,6865,6053,6616,320,6642,6638,7589,592,5954,6432,6633,320,6654,6646,6632,464,6650,0,6641,658,6877,6424,6644,320,6889,6065,6640,320,6666,6662,7585,592,5966,6452,6657,320,6678,6670,6656,464,6674,0,6665,658,6901,6444,6668,320,6913,6077,6664,320,6690,6686,7549,592,5634,6472,6681,320,6702,6694,6680,464,6698,0,6689,658,6925,6464,6692,320,6937,6089,6688,320,6714,6710,7545,592,5646,6492,6705,320,6726,6718,6704,464,6722,0,6713,658,6949,6484,6716,320,6961,6101,6712,320,6738,6734,7509,592,5314,6512,6729,320,6750,6742,6728,464,6746,0,6737,658,6973,6504,6740,320,6985,6113,6736,320,6762,6758,7505,592,5326,6532,6753,320,6774,6766,6752,464,6770,0,6761,658,6997,6524,6764,320,7009,6125,6760,320,6786,6782,7661,592,5986,6552,6777,320,6798,6790,6776,464,6794,0,6785,658,4490,6556,6788,320,5410,6140,6784,320,6810,6806,7657,592,5998,6576,6801,320,6822,6814,6800,464,6818,0,6809,658,4498,6580,6812,320,5422,6160,6808,320,6834,6830,7621,592,5666,6600,6825,320,6846,6838,6824,464,6842,0,6833,658,5698,6604,6836,320,5890,6180,6832,320,6858,6854,7617,592,5678,6624,6849,320,6870,6862,6848,464,6866,0,6857,658,5710,6628,6860,320,5902,6200,6856,320,6882,6878,7581,592,5346,6648,6873,320,6894,6886,6872,464,6890,0,6881,658,5378,6652,6884,320,5570,6220,6880,320,6906,6902,7577,592,5358,6672,6897,320,6918,6910,6896,464,6914,0,6905,658,5390,6676,6908,320,5582,6240,6904,320,6930,6926,7541,592,5826,6696,6921,320,6942,6934,6920,464,6938,0,6929,658,5858,6700,6932,320,5250,6260,6928,320,6954,6950,7537,592,5838,6720,6945,320,6966,6958,6944,464,6962,0,6953,658,5870,6724,6956,320,5262,6280,6952,320,6978,6974,7501,592,5506,6744,6969,320,6990,6982,6968,464,6986,0,6977,658,5538,6748,6980,320,5730,6300,6976,320,7002,6998,7497,592,5518,6768,6993,320,7014,7006,6992,464,7010,0,7001,658,5550,6772,7004,320,5742,6320,7000,320,7022,7024,7492,4194264,12,7037,7016,913,7017,7030,7254,4194240,7034,7040,7025,4194264,6,7038,7028,913,7053,7021,7033,320,7029,7046,7150,4194240,7050,7056,7041,4194264,3,7054,7044,913,7069,7036,7049,320,7045,7062,7106,4194240,7066,7072,7057,4194264,2,7070,7060,913,7085,7052,7065,320,7061,7078,7100,4194240,7082,7088,7073,4194264,1,7086,7076,913,7113,7068,7081,320,7077,7092,7096,4194240,7089,1,0,4194246,7090,32898,0,4194246,7074,32906,2147483648,4194246,7110,7116,7058,4194264,5,7114,7104,913,7129,7084,7109,320,7105,7122,7144,4194240,7126,7132,7117,4194264,4,7130,7120,913,7157,7112,7125,320,7121,7136,7140,4194240,7133,2147516416,2147483648,4194246,7134,32907,0,4194246,7118,2147483649,0,4194246,7154,7160,7042,4194264,9,7158,7148,913,7173,7128,7153,320,7149,7166,7210,4194240,7170,7176,7161,4194264,8,7174,7164,913,7189,7156,7169,320,7165,7182,7204,4194240,7186,7192,7177,4194264,7,7190,7180,913,7217,7172,7185,320,7181,7196,7200,4194240,7193,2147516545,2147483648,4194246,7194,32777,2147483648,4194246,7178,138,0,4194246,7214,7220,7162,4194264,11,7218,7208,913,7233,7188,7213,320,7209,7226,7248,4194240,7230,7236,7221,4194264,10,7234,7224,913,7261,7216,7229,320,7225,7240,7244,4194240,7237,136,0,4194246,7238,2147516425,0,4194246,7222,2147483658,0,4194246,7258,7264,7026,4194264,18,7262,7252,913,7277,7232,7257,320,7253,7270,7374,4194240,7274,7280,7265,4194264,15,7278,7268,913,7293,7260,7273,320,7269,7286,7330,4194240,7290,7296,7281,4194264,14,7294,7284,913,7309,7276,7289,320,7285,7302,7324,4194240,7306,7312,7297,4194264,13,7310,7300,913,7337,7292,7305,320,7301,7316,7320,4194240,7313,2147516555,0,4194246,7314,139,2147483648,4194246,7298,32905,2147483648,4194246,7334,7340,7282,4194264,17,7338,7328,913,7353,7308,7333,320,7329,7346,7368,4194240,7350,7356,7341,4194264,16,7354,7344,913,7381,7336,7349,320,7345,7360,7364,4194240,7357,32771,2147483648,4194246,7358,32770,2147483648,4194246,7342,128,2147483648,4194246,7378,7384,7266,4194264,21,7382,7372,913,7397,7352,7377,320,7373,7390,7434,4194240,7394,7400,7385,4194264,20,7398,7388,913,7413,7380,7393,320,7389,7406,7428,4194240,7410,7416,7401,4194264,19,7414,7404,913,7441,7396,7409,320,7405,7420,7424,4194240,7417,32778,0,4194246,7418,2147483658,2147483648,4194246,7402,2147516545,2147483648,4194246,7438,7444,7386,4194264,23,7442,7432,913,7457,7412,7437,320,7433,7450,7472,4194240,7454,7460,7445,4194264,22,7458,7448,913,7705,7440,7453,320,7449,7464,7468,4194240,7461,32896,2147483648,4194246,7462,2147483649,0,4194246,7446,2147516424,2147483648,4194246,6018,7481,7693,592,7493,7477,7482,4194240,6030,7490,7689,592,7494,7489,7485,4194240,7018,7480,7488,320,7502,6994,4286,0,7506,6970,7496,0,7510,6754,7500,0,7514,6730,7504,0,7518,6518,7508,0,7522,6498,7512,0,7526,6318,7516,0,7530,6298,7520,0,7534,6126,7524,0,7538,6114,7528,0,7542,6946,7532,0,7546,6922,7536,0,7550,6706,7540,0,7554,6682,7544,0,7558,6478,7548,0,7562,6458,7552,0,7566,6278,7556,0,7570,6258,7560,0,7574,6102,7564,0,7578,6090,7568,0,7582,6898,7572,0,7586,6874,7576,0,7590,6658,7580,0,7594,6634,7584,0,7598,6438,7588,0,7602,6418,7592,0,7606,6238,7596,0,7610,6218,7600,0,7614,6078,7604,0,7618,6066,7608,0,7622,6850,7612,0,7626,6826,7616,0,7630,6610,7620,0,7634,6586,7624,0,7638,6398,7628,0,7642,6378,7632,0,7646,6198,7636,0,7650,6178,7640,0,7654,6054,7644,0,7658,6042,7648,0,7662,6802,7652,0,7666,6778,7656,0,7670,6562,7660,0,7674,6538,7664,0,7678,6358,7668,0,7682,6338,7672,0,7686,6158,7676,0,7690,6138,7680,0,7694,7486,7684,0,7698,7478,7688,0,4077,7702,7692,0,1,7706,7697,17,4085,7456,7701,320,3917,7716,7712,0,7710,7722,7718,0,7709,7720,7714,0,7717,7721,7713,0,7730,7988,8008,0,7734,7888,7724,0,7738,7876,7728,0,7740,7768,7732,0,7736,7756,7744,0,7742,7765,7748,0,7746,7757,7752,0,7750,7760,7762,0,7741,7749,7764,0,7753,7766,7754,0,7758,7745,7761,0,7737,7784,7852,0,7860,7781,7778,0,7785,7782,7774,0,7786,7773,7777,0,7769,7776,7780,256,7816,7797,7794,0,7801,7798,7790,0,7802,7789,7793,0,7861,7792,7796,256,7832,7813,7810,0,7817,7814,7806,0,7818,7805,7809,0,7788,7808,7812,256,7868,7829,7826,0,7833,7830,7822,0,7834,7821,7825,0,7804,7824,7828,256,7872,7845,7842,0,7849,7846,7838,0,7850,7837,7841,0,7869,7840,7844,256,7770,7873,7858,0,7862,7866,7854,0,7772,7800,7856,256,7870,7874,7857,0,7820,7848,7864,256,7836,7853,7865,0,7733,7884,7880,0,7878,7885,7886,0,7877,7881,7882,0,7729,7904,7892,0,7890,7916,7896,0,7894,7901,7902,0,7906,7897,7898,0,7889,7908,7900,0,7905,7920,7912,0,7910,7925,7918,0,7893,7922,7914,0,7909,7926,7917,0,7928,7913,7921,0,7924,7964,7932,0,7930,7956,7946,0,8,7965,7972,721,8,7973,7984,721,7950,7982,7934,0,7954,7978,7944,0,7958,7970,7948,0,7933,7962,7952,0,256,7966,7957,273,7929,7937,7961,4194240,256,7974,7953,273,7938,7941,7969,4194240,256,7985,7949,273,8,7986,7945,721,7942,7977,7981,4194240,7725,7992,7994,0,7989,7996,7990,0,7993,7998,7997,0,8224,8009,8006,0,3918,8010,8002,0,7726,8001,8005,0,8018,8212,8225,0,8022,8176,8012,0,8026,8164,8016,0,8028,8056,8020,0,8024,8044,8032,0,8030,8053,8036,0,8034,8045,8040,0,8038,8048,8050,0,8029,8037,8052,0,8041,8054,8042,0,8046,8033,8049,0,8025,8072,8140,0,8148,8069,8066,0,8073,8070,8062,0,8074,8061,8065,0,8057,8064,8068,256,8104,8085,8082,0,8089,8086,8078,0,8090,8077,8081,0,8149,8080,8084,256,8120,8101,8098,0,8105,8102,8094,0,8106,8093,8097,0,8076,8096,8100,256,8156,8117,8114,0,8121,8118,8110,0,8122,8109,8113,0,8092,8112,8116,256,8160,8133,8130,0,8137,8134,8126,0,8138,8125,8129,0,8157,8128,8132,256,8058,8161,8146,0,8150,8154,8142,0,8060,8088,8144,256,8158,8162,8145,0,8108,8136,8152,256,8124,8141,8153,0,8021,8168,8170,0,8165,8172,8166,0,8169,8174,8173,0,8017,8184,8180,0,8178,8196,8186,0,8177,8188,8182,0,8185,8208,8192,0,8190,8204,8198,0,8181,8200,8194,0,8197,8209,8206,0,8193,8210,8202,0,8189,8201,8205,0,8013,8216,8218,0,8213,8220,8214,0,8217,8222,8221,0,8000,8014,3622,0,8232,165,449,0,8228,8244,8236,0,8234,8432,8456,0,8246,8248,8460,0,8233,8245,8240,4194240,8241,8452,8252,0,8250,8405,8258,0,8262,8302,8254,0,8264,8294,8256,0,8260,8284,8270,0,8274,8276,8266,4194264,0,8285,8268,849,8269,8282,8288,4194240,8329,8286,8277,0,8265,8273,8281,4194240,8278,8290,8289,0,255,8298,8261,465,0,8349,8293,721,8306,8354,8257,0,8308,8342,8300,0,8304,8332,8314,0,8318,8320,8310,4194264,0,8333,8312,849,8313,8326,8336,4194240,8330,8334,8321,0,8381,8280,8324,128,8309,8317,8325,4194240,8322,8338,8337,0,255,8346,8305,465,8,8350,8341,721,8401,8297,8345,4194240,8358,8406,8301,0,8360,8394,8352,0,8356,8384,8366,0,8370,8372,8362,4194264,0,8385,8364,849,8365,8378,8388,4194240,8382,8386,8373,0,8433,8328,8376,128,8361,8369,8377,4194240,8374,8390,8389,0,255,8398,8357,465,16,8402,8393,721,8453,8348,8397,4194240,8410,8253,8353,0,8412,8446,8404,0,8408,8436,8418,0,8422,8424,8414,4194264,0,8437,8416,849,8417,8430,8440,4194240,8434,8438,8425,0,8237,8380,8428,128,8413,8421,8429,4194240,8426,8442,8441,0,255,8450,8409,465,24,8454,8445,721,8249,8400,8449,4194240,8238,8461,8462,0,8242,8457,8458,0,6,8468,1,0,8465,1954047348,8472,4194242,8470,8473,8476,0,8474,8478,8477,0
+};
+
+void load_keccak(Net *net) {
+  reserve_nodes(net, sizeof(nodes) / sizeof(u32));
+  put_words(net, 0, nodes, sizeof(nodes) / sizeof(u32));
+  net->nodes_len = sizeof(nodes) / sizeof(u32);
+  find_redexes(net);
+}
+
+// Library API
+// ===========
+// Compiling with -DFM_NET_LIBRARY leaves out `main`, so a host can include
+// this file and drive nets itself: create or load one, call `reduce_steps`
+// with a budget or deadline until `is_normal`, then read or hash the result.
+// A net that outgrows its node limit comes back with `exhausted` set and its
+// remaining pairs still queued, rather than ending the process.
+
+// A fresh net that may grow up to `max_nodes_bytes` of node memory
+Net *net_create(u64 max_nodes_bytes) {
+  Net *net = malloc(sizeof(Net));
+  if (!net) return NULL;
+  net_init(net, max_nodes_bytes, 0);
+  return net;
+}
+
+void net_destroy(Net *net) {
+  net_free(net);
+  free(net);
+}
+
+// Loads a net file into a new net, or returns NULL if it can't be read or
+// doesn't fit in `max_nodes_bytes`
+Net *net_load(const char *path, u64 max_nodes_bytes) {
+  Net *net = net_create(max_nodes_bytes);
+  if (!net) return NULL;
+  if (!load_net(net, path)) {
+    net_destroy(net);
+    return NULL;
+  }
+  return net;
+}
+
+u32 is_normal(Net *net) {
+  return net->redex_len == 0;
+}
+
+// Batch runs
+// ==========
+// `run_batch` reduces many independent nets on a fixed pool of threads. Each
+// thread owns one net for the whole run and empties it between jobs, so the
+// pages its arenas committed are reused rather than mapped and faulted in
+// again, and a job allocates nothing: nets are read straight into the arena
+// and the normal form is hashed with the free list's buffer as scratch. Jobs
+// are the net files of a directory, in name order, or a stream of net files
+// back to back on stdin, which threads take turns reading under `input_lock`.
+// Each job prints a line with its Stats and the hash of its normal form, and
+// with `out_dir` also saves that normal form there.
+
+typedef struct Batch {
+  char **paths;
+  u32 paths_len;
+  int stream;
+  u32 next;
+  pthread_mutex_t input_lock;
+  pthread_mutex_t output_lock;
+  u64 max_mem;
+  u32 compact_at;
+  u32 schedule;
+  u32 prefetch;
+  u32 batch_ops;
+  const char *out_dir;
+  u32 jobs;
+  u32 failures;
+  u64 rewrites;
+} Batch;
+
+typedef struct BatchWorker {
+  Batch *batch;
+  Net net;
+  pthread_t thread;
+} BatchWorker;
+
+// Empties a net for the next job, keeping its committed memory
+void net_reset(Net *net) {
+  net->nodes_len = 0;
+  net->redex_len = 0;
+  net->freed_len = 0;
+  net->nodes_peak = 0;
+  net->pre_rewrites = 0;
+  net->source_size = 0;
+  net->source_hash = 0;
+  net->redex_end = (u32)(net->redex_mem.committed / 4);
+  net->freed_end = (u32)(net->freed_mem.committed / 4);
+  #ifdef FM_STATS
+  memset(&net->tele, 0, sizeof(net->tele));
+  #endif
+}
+
+// Loads the next job into the worker's net and names it; returns 0 when done
+u32 next_job(BatchWorker *w, u32 *job, char *name, u32 name_len) {
+  Batch *batch = w->batch;
+  while (1) {
+    net_reset(&w->net);
+    pthread_mutex_lock(&batch->input_lock);
+    *job = batch->next++;
+    int read;
+    if (batch->stream >= 0) {
+      snprintf(name, name_len, "stdin-%u.fmn", *job);
+      read = read_net(&w->net, batch->stream, name);
+      if (read < 0) {
+        // Nothing after a bad net can be trusted to start on a header
+        close(batch->stream);
+        batch->stream = -1;
+      }
+      pthread_mutex_unlock(&batch->input_lock);
+    } else {
+      pthread_mutex_unlock(&batch->input_lock);
+      if (*job >= batch->paths_len) return 0;
+      const char *path = batch->paths[*job];
+      const char *base = strrchr(path, '/');
+      snprintf(name, name_len, "%s", base ? base + 1 : path);
+      int fd = open(path, O_RDONLY);
+      if (fd < 0) {
+        printf("[ERROR]\nCan't open '%s'.\n", path);
+        read = -1;
+      } else {
+        read = read_net(&w->net, fd, path);
+        close(fd);
+        // Only a stream ends on an empty read; here it is a failed job
+        if (read == 0) {
+          printf("[ERROR]\n'%s' is empty or not a file.\n", path);
+          read = -1;
+        }
+      }
+    }
+    if (read > 0) return 1;
+    if (read == 0) return 0;
+    pthread_mutex_lock(&batch->output_lock);
+    batch->failures++;
+    pthread_mutex_unlock(&batch->output_lock);
+  }
+}
+
+void *batch_worker(void *arg) {
+  BatchWorker *w = arg;
+  Batch *batch = w->batch;
+  Net *net = &w->net;
+  char name[256];
+  char path[4096];
+  u32 job;
+  while (next_job(w, &job, name, sizeof(name))) {
+    double start = now();
+    Stats stats = reduce(net);
+    double secs = now() - start;
+    if (stats.exhausted) {
+      pthread_mutex_lock(&batch->output_lock);
+      printf("[ERROR]\n'%s' needs more than the node memory limit.\n", name);
+      batch->failures++;
+      pthread_mutex_unlock(&batch->output_lock);
+      continue;
+    }
+    u32 saved = 1;
+    if (batch->out_dir) {
+      snprintf(path, sizeof(path), "%s/%s", batch->out_dir, name);
+      saved = save_net(net, path);
+    }
+
+    // Hashes with the free list's buffer as scratch, now that it was saved
+    u64 len = net->nodes_len / 4;
+    u64 todo_bytes = (2 * len + 1) * sizeof(u64);
+    if (!arena_commit(&net->freed_mem, todo_bytes + len * sizeof(u32))) out_of_memory("free list");
+    u64 *todo = (u64*)net->freed_mem.base;
+    u32 *seen = (u32*)(net->freed_mem.base + todo_bytes);
+    memset(seen, 0, sizeof(u32) * len);
+    u64 hash = hash_nodes(net, seen, todo);
+    net->freed_len = 0;
+    pthread_mutex_lock(&batch->output_lock);
+    printf("%-6u %-32s %12lu %10lu %10.3f %016lx\n", job, name, net->pre_rewrites + stats.rewrites, stats.loops, secs * 1e3, hash);
+    batch->jobs++;
+    batch->failures += !saved;
+    batch->rewrites += net->pre_rewrites + stats.rewrites;
+    pthread_mutex_unlock(&batch->output_lock);
+  }
+  return NULL;
+}
+
+int compare_paths(const void *a, const void *b) {
+  return strcmp(*(char *const*)a, *(char *const*)b);
+}
+
+// Runs every net file in `input`, a directory, or on stdin if it is "-".
+// Returns the number of jobs that couldn't be read or saved.
+u32 run_batch(Batch *batch, const char *input, u32 threads) {
+  batch->paths = NULL;
+  batch->paths_len = 0;
+  batch->stream = -1;
+  if (strcmp(input, "-") == 0) {
+    batch->stream = STDIN_FILENO;
+  } else {
+    DIR *dir = opendir(input);
+    if (!dir) {
+      printf("[ERROR]\nCan't open directory '%s'.\n", input);
+      return 1;
+    }
+    u32 cap = 0;
+    for (struct dirent *entry; (entry = readdir(dir));) {
+      if (entry->d_name[0] == '.') continue;
+      if (batch->paths_len == cap) {
+        cap = cap ? cap * 2 : 64;
+        batch->paths = realloc(batch->paths, sizeof(char*) * cap);
+      }
+      u64 len = strlen(input) + strlen(entry->d_name) + 2;
+      char *path = malloc(len);
+      snprintf(path, len, "%s/%s", input, entry->d_name);
+      batch->paths[batch->paths_len++] = path;
+    }
+    closedir(dir);
+    qsort(batch->paths, batch->paths_len, sizeof(char*), compare_paths);
+  }
+  batch->next = 0;
+  batch->jobs = 0;
+  batch->failures = 0;
+  batch->rewrites = 0;
+  pthread_mutex_init(&batch->input_lock, NULL);
+  pthread_mutex_init(&batch->output_lock, NULL);
+  if (threads < 1) threads = 1;
+  BatchWorker *workers = malloc(sizeof(BatchWorker) * threads);
+  printf("%-6s %-32s %12s %10s %10s %s\n", "job", "net", "rewrites", "loops", "ms", "hash");
+  double start = now();
+  for (u32 t = 0; t < threads; ++t) {
+    BatchWorker *w = &workers[t];
+    w->batch = batch;
+    net_init(&w->net, batch->max_mem, 0);
+    w->net.compact_at = batch->compact_at;
+    w->net.schedule = batch->schedule;
+    w->net.prefetch = batch->prefetch;
+    w->net.batch_ops = batch->batch_ops;
+    if (pthread_create(&w->thread, NULL, batch_worker, w) != 0) {
+      printf("[ERROR]\nCan't start batch thread %u.\n", t);
+      exit(1);
+    }
+  }
+  for (u32 t = 0; t < threads; ++t) {
+    pthread_join(workers[t].thread, NULL);
+    net_free(&workers[t].net);
+  }
+  double secs = now() - start;
+  printf("jobs: %u, failed: %u, rewrites: %lu, seconds: %.3f, jobs/s: %.1f\n", batch->jobs, batch->failures, batch->rewrites, secs, batch->jobs / secs);
+  free(workers);
+  for (u32 i = 0; i < batch->paths_len; ++i) free(batch->paths[i]);
+  free(batch->paths);
+  pthread_mutex_destroy(&batch->input_lock);
+  pthread_mutex_destroy(&batch->output_lock);
+  return batch->failures;
+}
+
+// Benchmarks
+// ==========
+// Generated workloads keep their result on the root's port 1, like the
+// keccak net, so `hash_result` covers it. Builders link ports with `link_ports`,
+// which queues the initial redexes as a side effect.
+
+u32 mix32(u32 x) {
+  x ^= x >> 16;
+  x *= 0x7FEB352D;
+  x ^= x >> 15;
+  x *= 0x846CA68B;
+  x ^= x >> 16;
+  return x;
+}
+
+u32 build_root(Net *net) {
+  u32 root = alloc_node(net, NOD, 0);
+  link_ports(net, Pointer(root, 0), Pointer(root, 2));
+  return root;
+}
+
+// Combines `len` values pairwise with OP2 nodes of the given kind
+u64 build_fold(Net *net, u64 *vals, u32 len, u32 kind) {
+  while (len > 1) {
+    for (u32 i = 0; i < len / 2; ++i) {
+      u32 op = alloc_node(net, OP2, kind);
+      link_ports(net, Pointer(op, 1), vals[i * 2 + 1]);
+      link_ports(net, Pointer(op, 0), vals[i * 2]);
+      vals[i] = Pointer(op, 2);
+    }
+    if (len % 2) vals[len / 2] = vals[len - 1];
+    len = (len + 1) / 2;
+  }
+  return vals[0];
+}
+
+// Builds a complete tree of `depth` levels of NOD nodes and returns its root's
+// main port. Kinds start at `kind` and grow by `step` per level. The bottom
+// level's aux ports are linked to `leaves`, or recorded in `holes` if NULL.
+u64 build_tree(Net *net, u32 depth, u32 kind, u32 step, u64 *leaves, u64 *holes, u32 *next) {
+  u32 node = alloc_node(net, NOD, kind);
+  for (u32 slot = 1; slot <= 2; ++slot) {
+    if (depth > 1) {
+      link_ports(net, Pointer(node, slot), build_tree(net, depth - 1, kind + step, step, leaves, holes, next));
+    } else if (leaves) {
+      link_ports(net, Pointer(node, slot), leaves[(*next)++]);
+    } else {
+      holes[(*next)++] = Pointer(node, slot);
+    }
+  }
+  return Pointer(node, 0);
+}
+
+// Independent chains of OP2 nodes whose results are xor-ed together
+void build_numeric(Net *net) {
+  static const u32 kinds[] = {0, 1, 2, 7, 8, 9, 11, 12, 13, 14, 15};
+  u32 width = 2048;
+  u32 depth = 2048;
+  u32 root = build_root(net);
+  u64 *outs = malloc(sizeof(u64) * width);
+  for (u32 w = 0; w < width; ++w) {
+    u64 prev = Numeric(mix32(w));
+    for (u32 i = 0; i < depth; ++i) {
+      u32 seed = mix32(w * depth + i + 1);
+      u32 kind = kinds[seed % 11];
+      u32 op = alloc_node(net, OP2, kind);
+      link_ports(net, Pointer(op, 1), prev);
+      link_ports(net, Pointer(op, 0), Numeric(kind == 11 || kind == 12 ? seed >> 27 : seed));
+      prev = Pointer(op, 2);
+    }
+    outs[w] = prev;
+  }
+  link_ports(net, Pointer(root, 1), build_fold(net, outs, width, 9));
+  free(outs);
+}
+
+// A tree of duplicators, one kind per level, copying a tree of another kind;
+// a kind-0 tree mirroring the duplicators collects the copies
+void build_duplication(Net *net) {
+  u32 value_depth = 13;
+  u32 dup_depth = 9;
+  u32 root = build_root(net);
+  u64 *ports = malloc(sizeof(u64) * ((u64)1 << (value_depth > dup_depth ? value_depth : dup_depth)));
+  u32 next = 0;
+  u64 dups = build_tree(net, dup_depth, 2, 1, NULL, ports, &next);
+  next = 0;
+  link_ports(net, Pointer(root, 1), build_tree(net, dup_depth, 0, 0, ports, NULL, &next));
+  for (u32 i = 0; i < (1u << value_depth); ++i) {
+    ports[i] = Numeric(mix32(i));
+  }
+  next = 0;
+  link_ports(net, dups, build_tree(net, value_depth, 1, 0, ports, NULL, &next));
+  free(ports);
+}
+
+// Chains where each step tests a bit of the previous value and picks either a
+// constant or that value again, duplicating numbers along the way
+void build_branching(Net *net) {
+  u32 width = 1024;
+  u32 depth = 1024;
+  u32 root = build_root(net);
+  u64 *outs = malloc(sizeof(u64) * width);
+  for (u32 w = 0; w < width; ++w) {
+    u64 prev = Numeric(mix32(w));
+    for (u32 i = 0; i < depth; ++i) {
+      u32 seed = mix32(w * depth + i + 1);
+      u32 dup = alloc_node(net, NOD, 0xFFFE);
+      u32 test = alloc_node(net, OP2, 7);
+      u32 ite = alloc_node(net, ITE, 0xFFFF);
+      u32 pair = alloc_node(net, NOD, 0xFFFF);
+      link_ports(net, Pointer(test, 1), Pointer(dup, 1));
+      link_ports(net, Pointer(test, 0), Numeric(1u << (seed % 32)));
+      link_ports(net, Pointer(pair, 1), Numeric(seed));
+      link_ports(net, Pointer(pair, 2), Pointer(dup, 2));
+      link_ports(net, Pointer(ite, 1), Pointer(pair, 0));
+      link_ports(net, Pointer(ite, 0), Pointer(test, 2));
+      link_ports(net, Pointer(dup, 0), prev);
+      prev = Pointer(ite, 2);
+    }
+    outs[w] = prev;
+  }
+  link_ports(net, Pointer(root, 1), build_fold(net, outs, width, 0));
+  free(outs);
+}
+
+typedef struct Workload {
+  const char *name;
+  void (*build)(Net *net);
+  u64 rewrites;
+  u64 hash;
+} Workload;
+
+static const Workload workloads[] = {
+  {"keccak", load_keccak, 44067986, 0x1FFE912806EA6575},
+  {"numeric", build_numeric, 8392702, 0xD23A7C6F52349CB9},
+  {"duplication", build_duplication, 8371713, 0xABE6A0CA78C5E259},
+  {"branching", build_branching, 5244926, 0x2463447190CFE891},
+};
+
+// Restarts the kernel's peak resident set size from the current one. Where
+// that isn't allowed, the peak stays the process's peak so far.
+void reset_peak_resident() {
+  FILE *file = fopen("/proc/self/clear_refs", "w");
+  if (file) {
+    fputs("5", file);
+    fclose(file);
+  }
+}
+
+// Peak resident set size since the last reset, in bytes
+u64 peak_resident_bytes() {
+  u64 kb = 0;
+  char line[256];
+  FILE *file = fopen("/proc/self/status", "r");
+  if (file) {
+    while (fgets(line, sizeof(line), file)) {
+      if (sscanf(line, "VmHWM: %lu kB", &kb) == 1) break;
+    }
+    fclose(file);
+  }
+  return kb * 1024;
+}
+
+int compare_doubles(const void *a, const void *b) {
+  double x = *(const double*)a;
+  double y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+// Runs every workload `runs` times, checking rewrite counts and normal forms
+// against the expected values, and prints a table. With `json`, also writes
+// one JSON object per workload there. Returns the number of failed checks.
+u32 bench(u32 runs, u32 threads, u32 compact_at, u32 schedule, u32 prefetch, u32 batch_ops, const char *json) {
+  FILE *out = NULL;
+  if (json && !(out = fopen(json, "w"))) {
+    printf("[ERROR]\nCan't write '%s'.\n", json);
+    return 1;
+  }
+  u32 failures = 0;
+  double *times = malloc(sizeof(double) * runs);
+  printf("%-12s %12s %10s %10s %10s %12s %9s  %s\n", "net", "rewrites", "min_s", "median_s", "Mrw/s", "peak_nodes", "rss_MB", "check");
+  for (u32 w = 0; w < sizeof(workloads) / sizeof(Workload); ++w) {
+    const Workload *load = &workloads[w];
+    u64 rewrites = 0;
+    u64 hash = 0;
+    u32 peak_nodes = 0;
+    u64 rss = 0;
+    u32 ok = 1;
+    for (u32 r = 0; r < runs; ++r) {
+      reset_peak_resident();
+      Net net;
+      net_init(&net, MAX_NODES_BYTES, 0);
+      net.compact_at = compact_at;
+      net.schedule = schedule;
+      net.prefetch = prefetch;
+      net.batch_ops = batch_ops;
+      load->build(&net);
+      double start = now();
+      Stats stats = threads > 1 ? reduce_parallel(&net, threads) : reduce(&net);
+      times[r] = now() - start;
+      u64 run_hash = hash_result(&net);
+      if (r > 0 && (stats.rewrites != rewrites || run_hash != hash)) ok = 0;
+      rewrites = stats.rewrites;
+      hash = run_hash;
+      if (net.nodes_len > net.nodes_peak) net.nodes_peak = net.nodes_len;
+      if (net.nodes_peak / 4 > peak_nodes) peak_nodes = net.nodes_peak / 4;
+      u64 run_rss = peak_resident_bytes();
+      if (run_rss > rss) rss = run_rss;
+      net_free(&net);
+    }
+    if ((load->rewrites && rewrites != load->rewrites) || (load->hash && hash != load->hash)) ok = 0;
+    failures += !ok;
+    qsort(times, runs, sizeof(double), compare_doubles);
+    double median = times[runs / 2];
+    printf("%-12s %12lu %10.3f %10.3f %10.2f %12u %9.1f  %s\n", load->name, rewrites, times[0], median, rewrites / median / 1e6, peak_nodes, rss / 1048576.0, ok ? "ok" : "FAIL");
+    if (out) {
+      fprintf(out, "{\"net\":\"%s\",\"runs\":%u,\"threads\":%u,\"schedule\":\"%s\",\"prefetch\":%u,\"batch_ops\":%s,\"rewrites\":%lu,\"hash\":\"%016lx\",\"ok\":%s,", load->name, runs, threads, schedule_names[schedule], prefetch, batch_ops ? "true" : "false", rewrites, hash, ok ? "true" : "false");
+      fprintf(out, "\"min_s\":%.6f,\"median_s\":%.6f,\"rewrites_per_s\":%.0f,\"peak_nodes\":%u,\"rss_bytes\":%lu}\n", times[0], median, rewrites / median, peak_nodes, rss);
+    }
+  }
+  free(times);
+  if (out) fclose(out);
+  return failures;
+}
+
+#ifndef FM_NET_LIBRARY
+int main (int argc, char **argv) {
+  u32 threads = 1;
+  u32 shards = 1;
+  u32 runs = 0;
+  const char *json = NULL;
+  u64 max_mem = MAX_NODES_BYTES;
+  u32 huge = 0;
+  u32 compact_at = 1 << 20;
+  u32 schedule = SCHEDULE_LIFO;
+  u32 prefetch = 4;
+  u32 lazy = 0;
+  u32 batch_ops = 0;
+  u32 optimized = 0;
+  const char *batch_input = NULL;
+  u32 target = TARGET_FULL;
+  const char *input = NULL;
+  const char *output = NULL;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      output = argv[++i];
+    } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+      threads = (u32)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-P") == 0 && i + 1 < argc) {
+      shards = (u32)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+      max_mem = (u64)atoll(argv[++i]) << 20;
+    } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+      runs = (u32)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      json = argv[++i];
+    } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+      compact_at = (u32)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      const char *name = argv[++i];
+      for (schedule = 0; schedule < 3 && strcmp(name, schedule_names[schedule]) != 0; ++schedule);
+      if (schedule == 3) {
+        printf("[ERROR]\nUnknown schedule '%s'; expected lifo, fifo or sorted.\n", name);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+      const char *name = argv[++i];
+      lazy = 1;
+      if (strcmp(name, "whnf") == 0) {
+        target = TARGET_WHNF;
+      } else if (strcmp(name, "full") == 0) {
+        target = TARGET_FULL;
+      } else {
+        printf("[ERROR]\nUnknown target '%s'; expected whnf or full.\n", name);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+      prefetch = (u32)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      batch_input = argv[++i];
+    } else if (strcmp(argv[i], "-O") == 0) {
+      optimized = 1;
+    } else if (strcmp(argv[i], "-u") == 0) {
+      batch_ops = 1;
+    } else if (strcmp(argv[i], "-H") == 0) {
+      huge = 1;
+    } else {
+      input = argv[i];
+    }
+  }
+
+  if (runs > 0) {
+    return bench(runs, threads, compact_at, schedule, prefetch, batch_ops, json) ? 1 : 0;
+  }
+
+  // Reduces every net in a directory or stream, saving normal forms to `-o`
+  if (batch_input) {
+    Batch batch;
+    batch.max_mem = max_mem;
+    batch.compact_at = compact_at;
+    batch.schedule = schedule;
+    batch.prefetch = prefetch;
+    batch.batch_ops = batch_ops;
+    batch.out_dir = output;
+    return run_batch(&batch, batch_input, threads) ? 1 : 0;
+  }
+
+  Net net;
+  net_init(&net, max_mem, huge);
+  net.compact_at = compact_at;
+  net.schedule = schedule;
+  net.prefetch = prefetch;
+  net.batch_ops = batch_ops;
+  if (input) {
+    if (!(optimized ? load_optimized(&net, input) : load_net(&net, input))) return 1;
+  } else {
+    load_keccak(&net);
+    if (optimized) optimize(&net);
+  }
 
-  for (u32 i = 0; i < sizeof(nodes) / sizeof(u32); ++i) {
-    net.nodes[i] = nodes[i];
-    net.nodes_len += 1;
+  // Saves the loaded net instead of reducing it
+  if (output) {
+    return save_net(&net, output) ? 0 : 1;
   }
 
-  find_redexes(&net);
-  Stats stats = reduce(&net);
+  Stats stats = lazy ? reduce_lazy(&net, target)
+              : shards > 1 ? reduce_sharded(&net, shards)
+              : threads > 1 ? reduce_parallel(&net, threads)
+              : reduce(&net);
+  if (stats.exhausted) out_of_memory("node");
 
   // Must output 44067986
-  printf("rewrites: %d\n", stats.rewrites);
-  printf("loops: %d\n", stats.loops);
+  printf("rewrites: %lu\n", net.pre_rewrites + stats.rewrites);
+  if (net.pre_rewrites) printf("pre_rewrites: %lu\n", net.pre_rewrites);
+  printf("loops: %lu\n", stats.loops);
+  printf("result: %016lx\n", hash_result(&net));
+  #ifdef FM_STATS
+  print_telemetry(&stats);
+  #endif
 }
+#endif